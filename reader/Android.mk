@@ -4,12 +4,18 @@ cpp_src := \
 animation/AnimateClip.cpp \
 animation/AnimationClip.cpp \
 animation/AnimationManager.cpp \
+animation/AnimationPlayback.cpp \
+animation/AnimationBlender.cpp \
 animation/Easing.cpp \
 animation/Bezier.cpp \
 collider/Collider.cpp \
 collider/ColliderManager.cpp \
 collider/Contract.cpp \
 collider/Intersection.cpp \
+core/AnimationClipCache.cpp \
+core/DynamicAtlas.cpp \
+core/NodeDecoder.cpp \
+core/WorkerPool.cpp \
 CreatorReader.cpp \
 ui/PageView.cpp \
 ui/RichtextStringVisitor.cpp
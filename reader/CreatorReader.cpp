@@ -26,6 +26,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <iterator>
 #include <vector>
 
 #include "animation/AnimateClip.h"
@@ -53,121 +54,15 @@ USING_NS_CCR;
 static void setSpriteQuad(V3F_C4B_T2F_Quad* quad, const cocos2d::Size& origSize, const int x, const int y, float x_factor, float y_factor);
 static void tileSprite(cocos2d::Sprite* sprite);
 
-namespace
-{
-template <typename T, typename U>
-void setupAnimClipsPropValue(T fbPropList, U& proplist)
-{
-	if (fbPropList)
-	{
-		for (const auto fbProp : *fbPropList)
-		{
-			const auto fbFrame = fbProp->frame();
-			const auto fbValue = fbProp->value();
-
-			const auto fbCurveType = fbProp->curveType();
-			std::string curveType = fbCurveType ? fbCurveType->c_str() : "";
-
-			const auto fbCurveData = fbProp->curveData();
-			std::vector<float> curveData;
-			if (fbCurveData)
-				for (const auto& value : *fbCurveData)
-					curveData.push_back(value);
-
-			proplist.push_back({fbFrame, fbValue, curveData, curveType});
-		}
-	}
-}
-
-template <typename T, typename U>
-void setupAnimClipsPropString(T fbPropList, U& proplist)
-{
-	if (fbPropList)
-	{
-		for (const auto fbProp : *fbPropList)
-		{
-			const auto fbFrame = fbProp->frame();
-			const auto fbValue = fbProp->value();
-
-			const auto fbCurveType = fbProp->curveType();
-			std::string curveType = fbCurveType ? fbCurveType->c_str() : "";
-
-			const auto fbCurveData = fbProp->curveData();
-			std::vector<float> curveData;
-			if (fbCurveData)
-				for (const auto& value : *fbCurveData)
-					curveData.push_back(value);
-
-			proplist.push_back({fbFrame,
-				fbValue->str(),
-				curveData,
-				curveType});
-		}
-	}
-}
-
-template <typename T, typename U>
-void setupAnimClipsPropVec2(T fbPropList, U& proplist)
-{
-	if (fbPropList)
-	{
-		for (const auto fbProp : *fbPropList)
-		{
-			const auto fbFrame = fbProp->frame();
-			const auto fbValue = fbProp->value();
-
-			const auto fbCurveType = fbProp->curveType();
-			std::string curveType = fbCurveType ? fbCurveType->c_str() : "";
-
-			const auto fbCurveData = fbProp->curveData();
-			std::vector<float> curveData;
-			if (fbCurveData)
-				for (const auto& value : *fbCurveData)
-					curveData.push_back(value);
-
-			proplist.push_back({fbFrame,
-				cocos2d::Vec2(fbValue->x(), fbValue->y()),
-				curveData,
-				curveType});
-		}
-	}
-}
-
-template <typename T, typename U>
-void setupAnimClipsPropColor(T fbPropList, U& proplist)
-{
-	if (fbPropList)
-	{
-		for (const auto fbProp : *fbPropList)
-		{
-			const auto fbFrame = fbProp->frame();
-			const auto fbValue = fbProp->value();
-
-			const auto fbCurveType = fbProp->curveType();
-			std::string curveType = fbCurveType ? fbCurveType->c_str() : "";
-
-			const auto fbCurveData = fbProp->curveData();
-			std::vector<float> curveData;
-			if (fbCurveData)
-				for (const auto& value : *fbCurveData)
-					curveData.push_back(value);
-
-			proplist.push_back({fbFrame,
-				cocos2d::Color3B(fbValue->r(), fbValue->g(), fbValue->b()),
-				curveData,
-				curveType});
-		}
-	}
-}
-} // namespace
-
 //
 // Reader main class
 //
 Reader::Reader() :
-	_version(""),
-	_positionDiffDesignResolution(0, 0),
-	m_SpriteRectScale(1.0f)
+	m_SpriteRectScale(1.0f),
+	m_DynamicAtlasEnabled(false),
+	m_ParallelDecodeEnabled(false),
+	m_Context(&m_DefaultContext),
+	m_LifetimeToken(std::make_shared<char>())
 {
 	Reader::instance = this;
 
@@ -175,6 +70,7 @@ Reader::Reader() :
 	_collisionManager = new ColliderManager();
 	_widgetManager = new WidgetManager();
 	m_SpriteFrameCache = new SpriteFrameCache();
+	m_AnimationClipCache = new AnimationClipCache();
 
 	_animationManager->autorelease();
 	_collisionManager->autorelease();
@@ -187,6 +83,10 @@ Reader::Reader() :
 
 Reader::~Reader()
 {
+	// Loads still running use the caches below
+	this->joinLoadThreads(true);
+	m_LifetimeToken.reset();
+
 	// Stop all animations that were run by play on load
 	_animationManager->stopAnimationClipsRunByPlayOnLoad();
 	_animationManager->RemoveAllAnimations();
@@ -196,143 +96,186 @@ Reader::~Reader()
 	CC_SAFE_RELEASE_NULL(_widgetManager);
 
 	delete m_SpriteFrameCache;
+	delete m_AnimationClipCache;
+}
+
+bool Reader::readFile(ReaderContext& context, const std::string& filename) const
+{
+	FileUtils* fileUtils = FileUtils::getInstance();
+
+	const std::string& fullpath = fileUtils->fullPathForFilename(filename);
+	if (fullpath.empty())
+	{
+		return false;
+	}
+
+	context.filename = filename;
+	context.data = fileUtils->getDataFromFile(fullpath);
+	context.descriptors.clear();
+	context.decoded = false;
+
+	const void* buffer = context.data.getBytes();
+	auto nodeGraph = GetNodeGraph(buffer);
+	context.version = nodeGraph->version()->str();
+
+	return true;
+}
+
+void Reader::decode(ReaderContext& context) const
+{
+	if (m_ParallelDecodeEnabled && !context.decoded)
+	{
+		NodeDecoder::Decode(GetNodeGraph(context.data.getBytes())->root(), context.descriptors);
+		context.decoded = true;
+	}
 }
 
 bool Reader::loadScene(const std::string& filename)
 {
 	// File last read, that means data will still be present
-	if (_lastReadFile == filename)
+	if (m_DefaultContext.filename == filename)
 	{
 		return true;
 	}
 
-	_lastReadFile = filename;
-
-	FileUtils* fileUtils = FileUtils::getInstance();
-
-	const std::string& fullpath = fileUtils->fullPathForFilename(filename);
-	if (fullpath.empty())
+	if (!this->readFile(m_DefaultContext, filename))
 	{
 		CCLOG("Reader: Scene file not found: %s", filename.c_str());
 		return false;
 	}
 
-	_data = fileUtils->getDataFromFile(fullpath);
-
-	const void* buffer = _data.getBytes();
-	auto sceneGraph = GetNodeGraph(buffer);
-	_version = sceneGraph->version()->str();
-
-	this->setupScene();
+	this->setupScene(m_DefaultContext);
 
 	return true;
 }
 
 bool Reader::loadPrefab(const std::string& filename)
 {
-	// If mutex is locked, that means a thread is reading from a file
-	// Allow it to complete
+	// Guards the default context; loads with their own context don't need it
 	std::lock_guard<std::mutex> lock(m_Mutex);
 
 	// File last read, that means data will still be present
-	if (_lastReadFile == filename)
+	if (m_DefaultContext.filename == filename)
 	{
 		return true;
 	}
 
-	_lastReadFile = filename;
-	FileUtils* fileUtils = FileUtils::getInstance();
-
-	const std::string& fullpath = fileUtils->fullPathForFilename(filename);
-	if (fullpath.empty())
+	if (!this->readFile(m_DefaultContext, filename))
 	{
 		CCLOG("Reader: Prefab file not found: %s", filename.c_str());
 		return false;
 	}
 
-	_data = fileUtils->getDataFromFile(fullpath);
-
-	const void* buffer = _data.getBytes();
-	auto nodeGraph = GetNodeGraph(buffer);
-	_version = nodeGraph->version()->str();
-
-	this->setupPrefab();
+	this->setupPrefab(m_DefaultContext);
 
 	return true;
 }
 
-void Reader::loadPrefabAsync(const std::string& filename, const std::function<void(cocos2d::Node*)>& callback)
+std::shared_ptr<ReaderContext> Reader::loadSceneContext(const std::string& filename, const SpriteFrameSettings& settings)
 {
-	// Allow only one file to be read async
-	//	std::unique_lock<std::mutex> lock(m_Mutex);
-	//	m_RunIfFree.wait(lock, [this]() {
-	//		return m_Ready;
-	//	});
-
-	// if (_lastReadFile == filename)
-	// {
-	// 	callback(this->getNodeGraph());
-	// 	return;
-	// }
-
-	// Launch a thread to do the dirty work!
-	std::async(std::launch::async, [this, filename, &callback]() {
-		std::lock_guard<std::mutex> lock(m_Mutex);
-		m_ParsingScene = false;
-		FileUtils* fileUtils = FileUtils::getInstance();
-
-		const std::string& fullpath = fileUtils->fullPathForFilename(filename);
-		if (fullpath.empty())
-		{
-			callback(nullptr);
-			CCLOG("Reader: Prefab file not found: %s", filename.c_str());
-			return;
-		}
+	auto context = std::make_shared<ReaderContext>();
+	if (!this->readFile(*context, filename))
+	{
+		CCLOG("Reader: Scene file not found: %s", filename.c_str());
+		return nullptr;
+	}
 
-		auto buffer = fileUtils->getDataFromFile(fullpath).getBytes();
-		this->setupPrefab(buffer);
-		cocos2d::Director::getInstance()->getScheduler()->performFunctionInCocosThread([callback, buffer, this]() {
-			auto nodeGraph = GetNodeGraph(buffer);
-			auto nodeTree = nodeGraph->root();
+	// Design resolution and collisions are global state, they are set up by getSceneGraph(context) on the cocos thread
+	m_SpriteFrameCache->AddSpriteFrames(context->data.getBytes(), settings);
+	this->decode(*context);
 
-			cocos2d::Vec2 positionDiff;
-			const auto& designResolution = nodeGraph->designResolution();
-			if (designResolution)
-			{
-				const auto& realDesignResolution = Director::getInstance()->getOpenGLView()->getDesignResolutionSize();
-				positionDiff = cocos2d::Vec2((realDesignResolution.width - designResolution->w()) / 2, (realDesignResolution.height - designResolution->h()) / 2);
-			}
+	return context;
+}
 
-			cocos2d::Node* node = this->createTree(nodeTree);
+std::shared_ptr<ReaderContext> Reader::loadPrefabContext(const std::string& filename, const SpriteFrameSettings& settings)
+{
+	auto context = std::make_shared<ReaderContext>();
+	if (!this->readFile(*context, filename))
+	{
+		CCLOG("Reader: Prefab file not found: %s", filename.c_str());
+		return nullptr;
+	}
 
-			// Make Node at the center of screen
-			// should not just node's position because it is a Scene, and it will cause issue that click position is not correct(it is a bug of cocos2d-x)
-			// and should not change camera's position
-			for (auto& child : node->getChildren())
-			{
-				if (dynamic_cast<Camera*>(child) == nullptr)
-				{
-					child->setPosition(child->getPosition() + positionDiff);
-				}
-			}
+	// The design resolution is only read on the cocos thread, so the position diff is set up by getNodeGraph(context)
+	m_SpriteFrameCache->AddSpriteFrames(context->data.getBytes(), settings);
+	this->decode(*context);
 
-			auto prefab = static_cast<cocos2d::Node*>(node);
-			shiftOriginRecursively(prefab);
+	return context;
+}
 
-			auto actualPrefab = prefab->getChildren().at(0);
-			actualPrefab->removeFromParent();
+SpriteFrameSettings Reader::GetSpriteFrameSettings() const
+{
+	SpriteFrameSettings settings;
+	settings.rectScale = m_SpriteRectScale;
+	settings.basePath = m_SpriteBasePath;
+	settings.pathReplacements = m_PathReplacements;
+	return settings;
+}
 
-			callback(actualPrefab);
+void Reader::loadPrefabAsync(const std::string& filename, const std::function<void(cocos2d::Node*)>& callback)
+{
+	// Every async load reads into its own context, so loads neither wait for nor race with each other or loadScene.
+	// The spriteframe settings are copied here, the worker does not read the reader's.
+	const SpriteFrameSettings settings = this->GetSpriteFrameSettings();
+	this->joinLoadThreads(false);
+
+	std::unique_ptr<LoadThread> load(new LoadThread);
+	LoadThread* state = load.get();
+	std::weak_ptr<char> alive = m_LifetimeToken;
+	load->thread = std::thread([this, state, alive, filename, settings, callback]() {
+		std::shared_ptr<ReaderContext> context = this->loadPrefabContext(filename, settings);
+
+		// Runs after this thread is done, possibly once the reader is gone
+		cocos2d::Director::getInstance()->getScheduler()->performFunctionInCocosThread([this, alive, context, callback]() {
+			if (!alive.expired())
+				callback(context ? this->getNodeGraph(*context) : nullptr);
 		});
 
-		m_Ready = true;
-		//		m_RunIfFree.notify_one();
+		state->done = true;
 	});
+
+	std::lock_guard<std::mutex> lock(m_LoadThreadsMutex);
+	m_LoadThreads.push_back(std::move(load));
 }
 
-void Reader::setupScene()
+void Reader::joinLoadThreads(bool all)
 {
-	const void* buffer = _data.getBytes();
+	// Joined outside of the lock, a load may take a while to finish
+	std::vector<std::unique_ptr<LoadThread>> joined;
+	{
+		std::lock_guard<std::mutex> lock(m_LoadThreadsMutex);
+		auto it = std::partition(m_LoadThreads.begin(), m_LoadThreads.end(), [all](const std::unique_ptr<LoadThread>& load) {
+			return !all && !load->done;
+		});
+
+		std::move(it, m_LoadThreads.end(), std::back_inserter(joined));
+		m_LoadThreads.erase(it, m_LoadThreads.end());
+	}
+
+	for (auto& load : joined)
+	{
+		load->thread.join();
+	}
+}
+
+void Reader::setupScene(ReaderContext& context)
+{
+	this->setupDesignResolution(context);
+
+	m_SpriteFrameCache->AddSpriteFrames(context.data.getBytes());
+	this->setupCollisionMatrix(context);
+	this->setupPositionDiff(context);
+}
+
+void Reader::setupPrefab(ReaderContext& context)
+{
+	m_SpriteFrameCache->AddSpriteFrames(context.data.getBytes());
+	this->setupPositionDiff(context);
+}
+
+void Reader::setupDesignResolution(ReaderContext& context)
+{
+	const void* buffer = context.data.getBytes();
 	auto sceneGraph = GetNodeGraph(buffer);
 
 	const auto& designResolution = sceneGraph->designResolution();
@@ -361,30 +304,18 @@ void Reader::setupScene()
 			glview->setDesignResolutionSize(designResolution->w(), designResolution->h(), ResolutionPolicy::NO_BORDER);
 		}
 	}
-
-	m_SpriteFrameCache->AddSpriteFrames();
-	this->setupCollisionMatrix();
-
-	if (designResolution)
-	{
-		const auto& realDesignResolution = Director::getInstance()->getOpenGLView()->getDesignResolutionSize();
-		_positionDiffDesignResolution = cocos2d::Vec2((realDesignResolution.width - designResolution->w()) / 2,
-			(realDesignResolution.height - designResolution->h()) / 2);
-	}
 }
 
-void Reader::setupPrefab(const void* buffer)
+void Reader::setupPositionDiff(ReaderContext& context)
 {
-	buffer = buffer ? buffer : _data.getBytes();
-	auto sceneGraph = GetNodeGraph(buffer);
-
-	const auto& designResolution = sceneGraph->designResolution();
-	m_SpriteFrameCache->AddSpriteFrames(buffer);
+	const void* buffer = context.data.getBytes();
+	const auto& designResolution = GetNodeGraph(buffer)->designResolution();
 
 	if (designResolution)
 	{
 		const auto& realDesignResolution = Director::getInstance()->getOpenGLView()->getDesignResolutionSize();
-		_positionDiffDesignResolution = cocos2d::Vec2((realDesignResolution.width - designResolution->w()) / 2, (realDesignResolution.height - designResolution->h()) / 2);
+		context.positionDiffDesignResolution = cocos2d::Vec2((realDesignResolution.width - designResolution->w()) / 2,
+			(realDesignResolution.height - designResolution->h()) / 2);
 	}
 }
 
@@ -392,9 +323,9 @@ void Reader::setupSpriteFrames()
 {
 }
 
-void Reader::setupCollisionMatrix()
+void Reader::setupCollisionMatrix(ReaderContext& context)
 {
-	const void* buffer = _data.getBytes();
+	const void* buffer = context.data.getBytes();
 	const auto& nodeGraph = GetNodeGraph(buffer);
 	const auto& collisionMatrixBuffer = nodeGraph->collisionMatrix();
 
@@ -413,18 +344,36 @@ void Reader::setupCollisionMatrix()
 
 cocos2d::Scene* Reader::getSceneGraph()
 {
-	m_ParsingScene = true;
+	return this->createSceneGraph(m_DefaultContext);
+}
+
+cocos2d::Scene* Reader::getSceneGraph(ReaderContext& context)
+{
+	this->setupDesignResolution(context);
+	this->setupCollisionMatrix(context);
+	this->setupPositionDiff(context);
+
+	return this->createSceneGraph(context);
+}
+
+cocos2d::Scene* Reader::createSceneGraph(ReaderContext& context)
+{
+	// Frames registered by loads on other threads have to be in the cocos cache before nodes use them
+	m_SpriteFrameCache->PublishPendingSpriteFrames();
+
+	ReaderContext* previousContext = m_Context;
+	m_Context = &context;
+	context.parsingScene = true;
 
 	// Remove all old animations
 	_animationManager->RemoveSceneAnimations();
-
-	const void* buffer = _data.getBytes();
+	const void* buffer = context.data.getBytes();
 
 	auto sceneGraph = GetNodeGraph(buffer);
 	auto nodeTree = sceneGraph->root();
 
 	_widgetManager->clearWidgets();
-	cocos2d::Node* node = this->createTree(nodeTree);
+	cocos2d::Node* node = this->buildTree(nodeTree);
 
 	// Make scene at the center of screen
 	// should not just node's position because it is a Scene, and it will cause issue that click position is not correct(it is a bug of cocos2d-x)
@@ -433,7 +382,7 @@ cocos2d::Scene* Reader::getSceneGraph()
 	{
 		if (dynamic_cast<Camera*>(child) == nullptr)
 		{
-			child->setPosition(child->getPosition() + _positionDiffDesignResolution);
+			child->setPosition(child->getPosition() + context.positionDiffDesignResolution);
 		}
 	}
 
@@ -471,20 +420,37 @@ cocos2d::Scene* Reader::getSceneGraph()
 	}
 #endif
 
+	m_Context = previousContext;
 	return scene;
 }
 
 cocos2d::Node* Reader::getNodeGraph(cocos2d::Vec2* positionDiff)
 {
-	positionDiff = positionDiff ? positionDiff : &_positionDiffDesignResolution;
-	m_ParsingScene = false;
+	return this->createNodeGraph(m_DefaultContext, positionDiff ? *positionDiff : m_DefaultContext.positionDiffDesignResolution);
+}
+
+cocos2d::Node* Reader::getNodeGraph(ReaderContext& context)
+{
+	this->setupPositionDiff(context);
+
+	return this->createNodeGraph(context, context.positionDiffDesignResolution);
+}
+
+cocos2d::Node* Reader::createNodeGraph(ReaderContext& context, const cocos2d::Vec2& positionDiff)
+{
+	// Frames registered by loads on other threads have to be in the cocos cache before nodes use them
+	m_SpriteFrameCache->PublishPendingSpriteFrames();
+
+	ReaderContext* previousContext = m_Context;
+	m_Context = &context;
+	context.parsingScene = false;
 
-	const void* buffer = _data.getBytes();
+	const void* buffer = context.data.getBytes();
 
 	auto nodeGraph = GetNodeGraph(buffer);
 	auto nodeTree = nodeGraph->root();
 
-	cocos2d::Node* node = this->createTree(nodeTree);
+	cocos2d::Node* node = this->buildTree(nodeTree);
 
 	// Make Node at the center of screen
 	// should not just node's position because it is a Scene, and it will cause issue that click position is not correct(it is a bug of cocos2d-x)
@@ -493,7 +459,7 @@ cocos2d::Node* Reader::getNodeGraph(cocos2d::Vec2* positionDiff)
 	{
 		if (dynamic_cast<Camera*>(child) == nullptr)
 		{
-			child->setPosition(child->getPosition() + *positionDiff);
+			child->setPosition(child->getPosition() + positionDiff);
 		}
 	}
 
@@ -513,6 +479,7 @@ cocos2d::Node* Reader::getNodeGraph(cocos2d::Vec2* positionDiff)
 	auto actualPrefab = prefab->getChildren().at(0);
 	actualPrefab->removeFromParent();
 
+	m_Context = previousContext;
 	return actualPrefab;
 }
 
@@ -533,13 +500,39 @@ ColliderManager* Reader::getColliderManager() const
 
 std::string Reader::getVersion() const
 {
-	return _version;
+	return m_DefaultContext.version;
+}
+
+cocos2d::Node* Reader::buildTree(const buffers::NodeTree* tree) const
+{
+	// Unless the context was decoded while loading, decode now
+	this->decode(*m_Context);
+
+	m_Context->descriptorCursor = 0;
+	m_Context->currentDescriptor = nullptr;
+
+	cocos2d::Node* node = this->createTree(tree);
+
+	// Descriptors only hold what was read from the file data, so they are kept for the next build of this context
+	m_Context->currentDescriptor = nullptr;
+
+	return node;
+}
+
+const NodeDescriptor* Reader::getDescriptor(const buffers::Node* nodeBuffer) const
+{
+	// Nodes created internally by a parser (toggle group buttons, pages, ...) have no descriptor of their own
+	const NodeDescriptor* descriptor = m_Context->currentDescriptor;
+	return (descriptor && descriptor->source == nodeBuffer) ? descriptor : nullptr;
 }
 
 cocos2d::Node* Reader::createTree(const buffers::NodeTree* tree) const
 {
 	cocos2d::Node* node = nullptr;
 
+	// Descriptors are laid out in the order this visits the tree
+	m_Context->currentDescriptor = m_Context->decoded ? &m_Context->descriptors[m_Context->descriptorCursor++] : nullptr;
+
 	const void* buffer = tree->object();
 	buffers::AnyNode bufferType = tree->object_type();
 	bool parsing_button = false;
@@ -768,41 +761,38 @@ cocos2d::Node* Reader::createNode(const buffers::Node* nodeBuffer) const
 
 void Reader::parseNode(cocos2d::Node* node, const buffers::Node* nodeBuffer) const
 {
-	const auto& globalZOrder = nodeBuffer->globalZOrder();
-	node->setGlobalZOrder(globalZOrder);
-	const auto& localZOrder = nodeBuffer->localZOrder();
-	node->setLocalZOrder(localZOrder);
-	const auto& name = nodeBuffer->name();
-	if (name)
-		node->setName(name->str());
-	const auto& anchorPoint = nodeBuffer->anchorPoint();
-	if (anchorPoint)
-		node->setAnchorPoint(cocos2d::Vec2(anchorPoint->x(), anchorPoint->y()));
-	const auto& color = nodeBuffer->color();
-	if (color)
-		node->setColor(cocos2d::Color3B(color->r(), color->g(), color->b()));
-	const auto& opacity = nodeBuffer->opacity();
-	node->setOpacity(opacity);
-	const auto& cascadeOpacityEnabled = nodeBuffer->cascadeOpacityEnabled();
-	node->setCascadeOpacityEnabled(cascadeOpacityEnabled);
-	const auto& opacityModifyRGB = nodeBuffer->opacityModifyRGB();
-	node->setOpacityModifyRGB(opacityModifyRGB);
-	const auto position = nodeBuffer->position();
-	if (position)
-		node->setPosition(cocos2d::Vec2(position->x(), position->y()));
-	node->setRotationSkewX(nodeBuffer->rotationSkewX());
-	node->setRotationSkewY(nodeBuffer->rotationSkewY());
-	node->setScaleX(nodeBuffer->scaleX());
-	node->setScaleY(nodeBuffer->scaleY());
-	node->setSkewX(nodeBuffer->skewX());
-	node->setSkewY(nodeBuffer->skewY());
-	const auto& tag = nodeBuffer->tag();
-	node->setTag(tag);
-	const auto contentSize = nodeBuffer->contentSize();
-	if (contentSize)
-		node->setContentSize(cocos2d::Size(contentSize->w(), contentSize->h()));
-	const auto enabled = nodeBuffer->enabled();
-	node->setVisible(enabled);
+	// Unless it was decoded ahead, decode it now, so that both ways set the node up the same
+	NodeDescriptor nodeDescriptor;
+	const NodeDescriptor* descriptor = this->getDescriptor(nodeBuffer);
+	if (!descriptor)
+	{
+		NodeDecoder::DecodeNode(nodeBuffer, nodeDescriptor);
+		descriptor = &nodeDescriptor;
+	}
+
+	node->setGlobalZOrder(descriptor->globalZOrder);
+	node->setLocalZOrder(descriptor->localZOrder);
+	if (descriptor->hasName)
+		node->setName(descriptor->name);
+	if (descriptor->hasAnchorPoint)
+		node->setAnchorPoint(descriptor->anchorPoint);
+	if (descriptor->hasColor)
+		node->setColor(descriptor->color);
+	node->setOpacity(descriptor->opacity);
+	node->setCascadeOpacityEnabled(descriptor->cascadeOpacityEnabled);
+	node->setOpacityModifyRGB(descriptor->opacityModifyRGB);
+	if (descriptor->hasPosition)
+		node->setPosition(descriptor->position);
+	node->setRotationSkewX(descriptor->rotationSkewX);
+	node->setRotationSkewY(descriptor->rotationSkewY);
+	node->setScaleX(descriptor->scaleX);
+	node->setScaleY(descriptor->scaleY);
+	node->setSkewX(descriptor->skewX);
+	node->setSkewY(descriptor->skewY);
+	node->setTag(descriptor->tag);
+	if (descriptor->hasContentSize)
+		node->setContentSize(descriptor->contentSize);
+	node->setVisible(descriptor->visible);
 
 	// animation?
 	parseNodeAnimation(node, nodeBuffer);
@@ -870,113 +860,25 @@ void Reader::parseNodeAnimation(cocos2d::Node* node, const buffers::Node* nodeBu
 		bool hasDefaultAnimclip = animRef->defaultClip() != nullptr;
 		const auto& animationClips = animRef->clips();
 
-		cocos2d::FileUtils* fileUtils = cocos2d::FileUtils::getInstance();
 		for (const auto& fbAnimationClipName : *animationClips)
 		{
-			// Load the animation from the file
-			std::string fullpath = fileUtils->fullPathForFilename(std::string("animations/").append(fbAnimationClipName->str()).append(".anim"));
-			if (fullpath.empty())
+			// Loaded from the file the first time any node refers to it
+			auto animClip = m_AnimationClipCache->GetAnimationClip(fbAnimationClipName->str());
+			if (!animClip)
 			{
 				CCLOG("[CreatorReader.parseNodeAnimation]: %s.anim not found", fbAnimationClipName->c_str());
-				return;
+				continue;
 			}
 
-			cocos2d::Data data = fileUtils->getDataFromFile(fullpath);
-			auto fbAnimationClip = creator::buffers::GetAnimationClip(data.getBytes());
-
-			auto animClip = AnimationClip::create();
-
-			const auto& duration = fbAnimationClip->duration();
-			animClip->setDuration(duration);
-
-			const auto& speed = fbAnimationClip->speed();
-			animClip->setSpeed(speed);
-
-			const auto& sample = fbAnimationClip->sample();
-			animClip->setSample(sample);
-
-			const auto& name = fbAnimationClip->name();
-			animClip->setName(name->str());
-
-			const auto& wrapMode = fbAnimationClip->wrapMode();
-			animClip->setWrapMode(static_cast<AnimationClip::WrapMode>(wrapMode));
-
 			// Is it defalut animation clip?
-			if (hasDefaultAnimclip && name->str() == animRef->defaultClip()->str())
+			if (hasDefaultAnimclip && animClip->getName() == animRef->defaultClip()->str())
 				animationInfo.defaultClip = animClip;
 
-			const auto& curveDatas = fbAnimationClip->curveData();
-			for (const auto& fbCurveData : *curveDatas)
-			{
-				if (fbCurveData)
-				{
-					const AnimProps* fbAnimProps = fbCurveData->props();
-					AnimProperties properties;
-
-					// position
-					setupAnimClipsPropVec2(fbAnimProps->position(), properties.animPosition);
-
-					// position X
-					setupAnimClipsPropValue(fbAnimProps->positionX(), properties.animPositionX);
-
-					// position Y
-					setupAnimClipsPropValue(fbAnimProps->positionY(), properties.animPositionY);
-
-					// rotation
-					setupAnimClipsPropValue(fbAnimProps->rotation(), properties.animRotation);
-
-					// skew X
-					setupAnimClipsPropValue(fbAnimProps->skewX(), properties.animSkewX);
-
-					// skew Y
-					setupAnimClipsPropValue(fbAnimProps->skewY(), properties.animSkewY);
-
-					// scaleX
-					setupAnimClipsPropValue(fbAnimProps->scaleX(), properties.animScaleX);
-
-					// scaleY
-					setupAnimClipsPropValue(fbAnimProps->scaleY(), properties.animScaleY);
-
-					// Color
-					setupAnimClipsPropColor(fbAnimProps->color(), properties.animColor);
-
-					// opacity
-					setupAnimClipsPropValue(fbAnimProps->opacity(), properties.animOpacity);
-
-					// anchor x
-					setupAnimClipsPropValue(fbAnimProps->anchorX(), properties.animAnchorX);
-
-					// anchor y
-					setupAnimClipsPropValue(fbAnimProps->anchorY(), properties.animAnchorY);
-
-					// Active state
-					setupAnimClipsPropValue(fbAnimProps->active(), properties.animActive);
-
-					// Width
-					setupAnimClipsPropValue(fbAnimProps->width(), properties.animWidth);
-
-					// Height
-					setupAnimClipsPropValue(fbAnimProps->height(), properties.animHeight);
-
-					// SpriteFrame
-					setupAnimClipsPropString(fbAnimProps->spriteFrame(), properties.animSpriteFrame);
-
-					// path: self's animation doesn't have path
-					// path is used for sub node
-					if (fbCurveData->path())
-					{
-						properties.path = fbCurveData->path()->str();
-					}
-
-					animClip->addAnimProperties(properties);
-				}
-			}
-
 			animationInfo.clips.pushBack(animClip);
 		}
 
 		// record animation information -> {node: AnimationInfo}
-		animationInfo.attachedToScene = m_ParsingScene;
+		animationInfo.attachedToScene = m_Context->parsingScene;
 		_animationManager->addAnimation(animationInfo);
 	}
 }
@@ -1401,23 +1303,37 @@ void Reader::parseTilemap(cocos2d::TMXTiledMap* tilemap, const buffers::TileMap*
 cocos2d::Label* Reader::createLabel(const buffers::Label* labelBuffer) const
 {
 	cocos2d::Label* label = nullptr;
-	auto text = labelBuffer->labelText();
 	auto fontSize = labelBuffer->fontSize();
-	auto fontName = labelBuffer->fontName();
+
+	const NodeDescriptor* descriptor = this->getDescriptor(labelBuffer->node());
+	// Use the decoded strings in place, only copy out of the buffer when there is no descriptor
+	std::string bufferText, bufferFontName;
+	const std::string* text = &bufferText;
+	const std::string* fontName = &bufferFontName;
+	if (descriptor)
+	{
+		text = &descriptor->labelText;
+		fontName = &descriptor->fontName;
+	}
+	else
+	{
+		bufferText = labelBuffer->labelText()->str();
+		bufferFontName = labelBuffer->fontName()->str();
+	}
 
 	auto fontType = labelBuffer->fontType();
 	switch (fontType)
 	{
 	case buffers::FontType_TTF:
-		label = cocos2d::Label::createWithTTF(text->str(), fontName->str(), fontSize);
+		label = cocos2d::Label::createWithTTF(*text, *fontName, fontSize);
 		break;
 	case buffers::FontType_BMFont:
-		label = cocos2d::Label::createWithBMFont(fontName->str(), text->str());
+		label = cocos2d::Label::createWithBMFont(*fontName, *text);
 		if (label)
 			label->setBMFontSize(fontSize);
 		break;
 	case buffers::FontType_System:
-		label = cocos2d::Label::createWithSystemFont(text->str(), fontName->str(), fontSize);
+		label = cocos2d::Label::createWithSystemFont(*text, *fontName, fontSize);
 		break;
 	}
 
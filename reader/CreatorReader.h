@@ -23,6 +23,7 @@
  ****************************************************************************/
 #pragma once
 
+#include <atomic>
 #include <map>
 #include <mutex>
 #include <thread>
@@ -38,6 +39,8 @@
 #include "cocos2d.h"
 #include "ui/CocosGUI.h"
 
+#include "core/AnimationClipCache.h"
+#include "core/NodeDecoder.h"
 #include "core/SpriteFrameCache.h"
 
 #include "animation/AnimationClip.h"
@@ -63,6 +66,26 @@ class ParticleSystem;
 class WidgetManager;
 class RichText;
 
+// Everything a single load reads and creates nodes from. Loads with separate contexts can run concurrently;
+// node creation from a context still has to happen on the cocos thread.
+struct ReaderContext
+{
+	std::string filename;
+	cocos2d::Data data;
+	std::string version;
+	bool parsingScene = false;
+
+	// creator will make scene at the center of screen when apply design solution strategy, cocos2d-x doesn't do it like this
+	// this value record the diff
+	cocos2d::Vec2 positionDiffDesignResolution;
+
+	// Decoded descriptors of the tree (if parallel decoding is enabled), and the one of the entry being parsed
+	std::vector<NodeDescriptor> descriptors;
+	bool decoded = false;
+	size_t descriptorCursor = 0;
+	const NodeDescriptor* currentDescriptor = nullptr;
+};
+
 class Reader
 {
 	friend class SpriteFrameCache;
@@ -76,14 +99,37 @@ private:
 	// Same as above, this can be used to fetch non-atlas sprites from HD/SD directories
 	std::string m_SpriteBasePath;
 
+	// Pack standalone (split_qualities/no_split) spriteframes into shared atlas pages while loading, so they can be batched
+	bool m_DynamicAtlasEnabled;
+
+	// Decode node properties on worker threads before creating the nodes (see NodeDecoder)
+	bool m_ParallelDecodeEnabled;
+
 	// If you wish to replace any paths while reading spriteframes, use this!
 	std::unordered_map<std::string, std::string> m_PathReplacements;
-	
-	bool m_ParsingScene = false;
 
-	bool m_Ready = true;
+	// Context used by loadScene/loadPrefab and the matching graph getters
+	ReaderContext m_DefaultContext;
 	std::mutex m_Mutex;
-	std::condition_variable m_RunIfFree;
+
+	// Context of the graph being created
+	ReaderContext* m_Context;
+
+	// Threads of loadPrefabAsync, joined before the reader goes away
+	struct LoadThread
+	{
+		std::thread thread;
+		std::atomic<bool> done{false};
+	};
+
+	std::mutex m_LoadThreadsMutex;
+	std::vector<std::unique_ptr<LoadThread>> m_LoadThreads;
+
+	// Expires with the reader. Load callbacks queued on the cocos thread check it before using the reader.
+	std::shared_ptr<char> m_LifetimeToken;
+
+	// @param all	Whether to wait for the running loads too, or only reap the finished ones
+	void joinLoadThreads(bool all);
 
 public:
 	static Reader* i() { return Reader::instance; }
@@ -95,10 +141,61 @@ public:
 	bool loadPrefab(const std::string& filename);
 	void loadPrefabAsync(const std::string& filename, const std::function<void(cocos2d::Node*)>& callback);
 
+	/**
+	 Reads a scene into a context of its own, registering its spriteframes. Safe to call from any thread.
+	 @param settings	Spriteframe settings to read it with, from GetSpriteFrameSettings on the cocos thread
+	 @return The context to pass to `getSceneGraph(context)`, or nullptr if the file was not found
+	 */
+	std::shared_ptr<ReaderContext> loadSceneContext(const std::string& filename, const SpriteFrameSettings& settings);
+
+	/**
+	 Reads a prefab into a context of its own, registering its spriteframes. Safe to call from any thread.
+	 @param settings	Spriteframe settings to read it with, from GetSpriteFrameSettings on the cocos thread
+	 @return The context to pass to `getNodeGraph(context)`, or nullptr if the file was not found
+	 */
+	std::shared_ptr<ReaderContext> loadPrefabContext(const std::string& filename, const SpriteFrameSettings& settings);
+
 	inline void SetSpriteRectScale(float value) { m_SpriteRectScale = value; }
 	inline float GetSpriteRectScale() const { return m_SpriteRectScale; }
 	inline void SetSpriteBasePath(const std::string& value) { m_SpriteBasePath = value; }
 	inline std::string GetSpriteBasePath() const { return m_SpriteBasePath; }
+
+	// Copy of the settings spriteframes are loaded with, for loads on other threads. Only on the cocos thread.
+	SpriteFrameSettings GetSpriteFrameSettings() const;
+
+	/**
+	 Switches the already loaded split_qualities spriteframes to another quality tier in place, without a reload.
+	 Textures stream in on a worker thread, the swap itself happens at once on the cocos thread. Only sprites of the
+	 running scene are refreshed, see RefreshSplitSprites for the others.
+	 @param scale		New value for the sprite rect scale
+	 @param basePath	New value for the sprite base path
+	 @param callback	Called on the cocos thread with true once the switch is applied, false if a later switch superseded it
+	 */
+	inline void SwitchSpriteQuality(float scale, const std::string& basePath, const std::function<void(bool)>& callback = nullptr)
+	{
+		m_SpriteFrameCache->SwitchSplitQuality(scale, basePath, callback);
+	}
+
+	// Refreshes the sprites under `root` after SwitchSpriteQuality, for nodes that were not in the running scene
+	inline void RefreshSplitSprites(cocos2d::Node* root) { m_SpriteFrameCache->RefreshSplitSprites(root); }
+
+	/**
+	 Loads .anim clips on a worker thread, so that scenes and prefabs using them do not read them while loading
+	 @param names		Clip names, as referred to by nodes (animations/<name>.anim)
+	 @param callback	Called on the cocos thread once all of them are loaded
+	 */
+	inline void PreloadAnimationClips(const std::vector<std::string>& names, const std::function<void()>& callback = nullptr)
+	{
+		m_AnimationClipCache->PreloadAnimationClips(names, callback);
+	}
+
+	// Drops the spriteframes registered by earlier loads, and the dynamic atlas pages they were packed into
+	inline void RemoveSpriteFrames() { m_SpriteFrameCache->RemoveSpriteFrames(); }
+
+	inline void SetDynamicAtlasEnabled(bool value) { m_DynamicAtlasEnabled = value; }
+	inline bool IsDynamicAtlasEnabled() const { return m_DynamicAtlasEnabled; }
+	inline void SetParallelDecodeEnabled(bool value) { m_ParallelDecodeEnabled = value; }
+	inline bool IsParallelDecodeEnabled() const { return m_ParallelDecodeEnabled; }
 	inline void AddPathReplacement(const std::string& src, const std::string& dst) { m_PathReplacements.emplace(src, dst); }
 
 	/**
@@ -113,12 +210,24 @@ public:
      */
 	cocos2d::Scene* getSceneGraph();
 
+	/**
+     Returns the scenegraph of a context returned by `loadSceneContext`. Must be called on the cocos thread.
+     @return A `Scene*`
+     */
+	cocos2d::Scene* getSceneGraph(ReaderContext& context);
+
 	/**
      Returns the node graph contained in the .ccreator file
      @return A `Node*`
      */
 	cocos2d::Node* getNodeGraph(cocos2d::Vec2* positionDiff = nullptr);
 
+	/**
+     Returns the node graph of a context returned by `loadPrefabContext`. Must be called on the cocos thread.
+     @return A `Node*`
+     */
+	cocos2d::Node* getNodeGraph(ReaderContext& context);
+
 	/**
      Return the AnimationManager. It is added as a child of the Scene to simplify the codes.
      @return The `AnimationManager` of the scene
@@ -151,8 +260,22 @@ protected:
 	 Setup the needed spritesheets and change the design resolution if needed.
 	 Call it before getting the Scene graph
 	 */
-	virtual void setupScene();
-	virtual void setupPrefab(const void* buffer = nullptr);
+	virtual void setupScene(ReaderContext& context);
+	virtual void setupPrefab(ReaderContext& context);
+	void setupDesignResolution(ReaderContext& context);
+	void setupPositionDiff(ReaderContext& context);
+
+	// Reads the file into the context, leaving it untouched if the file does not exist
+	bool readFile(ReaderContext& context, const std::string& filename) const;
+	// Runs the decode stage for the context if parallel decoding is enabled and it did not run yet
+	void decode(ReaderContext& context) const;
+
+	cocos2d::Scene* createSceneGraph(ReaderContext& context);
+	cocos2d::Node* createNodeGraph(ReaderContext& context, const cocos2d::Vec2& positionDiff);
+
+	// Creates the tree of the current context, using its descriptors if it has been decoded
+	cocos2d::Node* buildTree(const buffers::NodeTree* treeBuffer) const;
+	const NodeDescriptor* getDescriptor(const buffers::Node* nodeBuffer) const;
 
 	cocos2d::Node* createTree(const buffers::NodeTree* treeBuffer) const;
 
@@ -243,7 +366,7 @@ protected:
 	void parseMotionStreak(cocos2d::MotionStreak* motionStreak, const buffers::MotionStreak* motionStreakBuffer) const;
 
 	void setupSpriteFrames();
-	void setupCollisionMatrix();
+	void setupCollisionMatrix(ReaderContext& context);
 
 	/** Creator uses parent's anchorpoint for child positioning.
      cocos2d-x uses parent's (0,0) for child positioning
@@ -251,18 +374,11 @@ protected:
 	void adjustPosition(cocos2d::Node* node) const;
 
 	// variables
-	std::string _lastReadFile;
-	cocos2d::Data _data;
-	std::string _version;
-
 	AnimationManager* _animationManager;
 	ColliderManager* _collisionManager;
 	WidgetManager* _widgetManager;
 	SpriteFrameCache* m_SpriteFrameCache;
-
-	// creator will make scene at the center of screen when apply design solution strategy, cocos2d-x doesn't do it like this
-	// this value record the diff
-	cocos2d::Vec2 _positionDiffDesignResolution;
+	AnimationClipCache* m_AnimationClipCache;
 
 	CREATOR_DISALLOW_COPY_ASSIGN_AND_MOVE(Reader);
 };
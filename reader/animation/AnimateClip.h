@@ -23,59 +23,71 @@
  ****************************************************************************/
 #pragma once
 
+#include <cstdint>
 #include <functional>
-#include <utility>
 
 #include "cocos2d.h"
-#include "ui/CocosGUI.h"
 
 #include "../Macros.h"
+#include "AnimationClip.h"
 
 NS_CCR_BEGIN
 
-class AnimationClip;
-struct AnimProperties;
+class AnimationManager;
 
+// Node facade over a playback run by AnimationManager. The manager advances every running clip from one tick, so this
+// only forwards to it; it is kept so code written against the node based API keeps working.
 class AnimateClip : public cocos2d::Node
 {
 public:
 	typedef std::function<void()> AnimateEndCallback;
+	typedef std::function<void(cocos2d::Node* target, const AnimEvent& event)> AnimateEventCallback;
 
 	static AnimateClip* createWithAnimationClip(cocos2d::Node* rootTarget, AnimationClip* clip);
 
+	// Starts the clip on the reader's AnimationManager, which keeps this object alive until the clip ends
 	void startAnimate();
 	void stopAnimate();
 	void pauseAnimate();
 	void resumeAnimate();
 
 	void setCallbackForEndevent(const AnimateEndCallback& callback);
+	// Called with the clip's events instead of AnimationManager's event callback
+	void setCallbackForEvent(const AnimateEventCallback& callback);
 	inline AnimationClip* getClip() const { return _clip; }
 
+	// Override the clip's values for this play only
+	void setSpeed(float speed);
+	inline float getSpeed() const { return _speed; }
+	void setWrapMode(AnimationClip::WrapMode wrapMode);
+	inline AnimationClip::WrapMode getWrapMode() const { return _wrapMode; }
+
 	virtual ~AnimateClip();
 
 	//
 	// Overrides
 	//
+
+	// Advances only this clip, on top of the manager's tick. Scaled like the tick, but not stepped by
+	// AnimationManager::setFixedTimeStep.
 	virtual void update(float dt) override;
 
 private:
+	friend class AnimationManager;
+
 	AnimateClip();
 	bool initWithAnimationClip(cocos2d::Node* rootTarget, AnimationClip* clip);
-	void doUpdate(const AnimProperties& animProperties, bool lastFrame = false) const;
-	cocos2d::Node* getTarget(const std::string& path) const;
-	float computeElapse() const;
 
 	AnimationClip* _clip;
-
-	// the time elapsed since the animation start
-	float _elapsed;
 	cocos2d::Node* _rootTarget;
-
 	AnimateEndCallback _endCallback;
-	bool _needStop;
-	float _durationToStop;
+	AnimateEventCallback _eventCallback;
+	float _speed;
+	AnimationClip::WrapMode _wrapMode;
 
-	bool _currentFramePlayed;
+	// Set once started
+	AnimationManager* _manager;
+	uint32_t _playbackId;
 };
 
 NS_CCR_END
@@ -0,0 +1,190 @@
+/****************************************************************************
+ Copyright (c) 2017 Chukong Technologies Inc.
+
+ http://www.cocos2d-x.org
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ****************************************************************************/
+
+#include "AnimationBlender.h"
+#include "AnimationClip.h"
+
+#include <algorithm>
+
+USING_NS_CCR;
+
+namespace
+{
+// Entries of nodes no longer blended kept for reuse before they are dropped
+const size_t kIdleEntries = 32;
+}
+
+void AnimationBlender::add(const AnimationPlayback::Target& target, AnimTrackType type, const float* value, float weight, AnimationPlayback::Applier applier, const AnimationClip* clip)
+{
+	auto it = _indices.find(target.node);
+	if (it == _indices.end())
+	{
+		it = _indices.emplace(target.node, _entries.size()).first;
+		_entries.emplace_back();
+	}
+
+	Entry& entry = _entries[it->second];
+	if (entry.types == 0)
+	{
+		// A node freed since may have been given the same address, the target is taken again each frame
+		entry.target = target;
+		_pending.push_back(it->second);
+	}
+
+	const size_t index = static_cast<size_t>(type);
+	const uint32_t bit = 1u << index;
+	float* sum = &entry.values[index * 3];
+	const uint8_t components = AnimationClip::getComponentCount(type);
+
+	if (!(entry.baseTypes & bit))
+	{
+		AnimationPlayback::readValue(target, type, &entry.bases[index * 3]);
+		entry.baseTypes |= bit;
+	}
+
+	if (AnimationClip::isStepped(type))
+	{
+		if ((entry.types & bit) && entry.weights[index] >= weight)
+			return;
+
+		std::copy(value, value + components, sum);
+		entry.weights[index] = weight;
+		entry.clips[index] = clip;
+	}
+	else
+	{
+		if (!(entry.types & bit))
+		{
+			std::fill(sum, sum + components, 0.f);
+			entry.weights[index] = 0;
+		}
+
+		for (uint8_t i = 0; i < components; ++i)
+		{
+			sum[i] += value[i] * weight;
+		}
+
+		entry.weights[index] += weight;
+		entry.clips[index] = clip;
+	}
+
+	entry.appliers[index] = applier;
+	entry.types |= bit;
+}
+
+void AnimationBlender::apply()
+{
+	// Nodes not blended this frame start from their own values again next time
+	for (auto& entry : _entries)
+	{
+		if (entry.types == 0)
+			entry.baseTypes = 0;
+	}
+
+	for (size_t index : _pending)
+	{
+		Entry& entry = _entries[index];
+		const auto& target = entry.target;
+
+		// Same order as AnimationPlayback::apply, position X and Y together
+		float x = 0, y = 0;
+		bool animateX = false, animateY = false;
+
+		for (size_t i = 0; i < kTypeCount; ++i)
+		{
+			if (!(entry.types & (1u << i)))
+				continue;
+
+			const auto type = static_cast<AnimTrackType>(i);
+			if ((animateX || animateY) && type > AnimTrackType::PositionY)
+			{
+				AnimationPlayback::setPositionXY(target.node, animateX, x, animateY, y);
+				animateX = animateY = false;
+			}
+
+			float* value = &entry.values[i * 3];
+			if (!AnimationClip::isStepped(type))
+			{
+				const uint8_t components = AnimationClip::getComponentCount(type);
+				const float weight = entry.weights[i];
+				if (weight >= 1)
+				{
+					for (uint8_t c = 0; c < components; ++c)
+					{
+						value[c] /= weight;
+					}
+				}
+				else
+				{
+					const float* base = &entry.bases[i * 3];
+					for (uint8_t c = 0; c < components; ++c)
+					{
+						value[c] += base[c] * (1 - weight);
+					}
+				}
+			}
+
+			switch (type)
+			{
+			case AnimTrackType::PositionX:
+				x = value[0];
+				animateX = true;
+				break;
+			case AnimTrackType::PositionY:
+				y = value[0];
+				animateY = true;
+				break;
+			default:
+				if (entry.appliers[i])
+					entry.appliers[i](target, value, entry.clips[i]);
+				break;
+			}
+		}
+
+		if (animateX || animateY)
+			AnimationPlayback::setPositionXY(target.node, animateX, x, animateY, y);
+
+		// Bases of the types no longer blended are dropped
+		entry.baseTypes &= entry.types;
+		entry.types = 0;
+	}
+
+	// Drop the idle entries once there are many of them. The blended ones are kept along with their bases, read again
+	// they would be this frame's output rather than the node's own value.
+	if (_entries.size() > _pending.size() + kIdleEntries)
+	{
+		auto end = std::remove_if(_entries.begin(), _entries.end(), [](const Entry& entry) {
+			return entry.baseTypes == 0;
+		});
+
+		_entries.erase(end, _entries.end());
+		_indices.clear();
+		for (size_t i = 0; i < _entries.size(); ++i)
+		{
+			_indices.emplace(_entries[i].target.node, i);
+		}
+	}
+
+	_pending.clear();
+}
@@ -0,0 +1,87 @@
+/****************************************************************************
+ Copyright (c) 2017 Chukong Technologies Inc.
+
+ http://www.cocos2d-x.org
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ****************************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "../Macros.h"
+#include "AnimationClipProperties.h"
+#include "AnimationPlayback.h"
+
+NS_CCR_BEGIN
+
+// Mixes the clips blended on the same nodes (see AnimationPlayback::isBlended). Their values are added up per node and
+// property over the frame, then each property is written once, however many clips animate it. The buffers are kept
+// from one frame to the next, a frame of the same blends allocates nothing.
+class AnimationBlender
+{
+public:
+	/**
+	 Adds `weight` of a value to the node's property.
+	 @param value	The value, in `AnimTrack::components` floats
+	 @param applier	The track's setter, see AnimationPlayback::Applier
+	 @param clip	The clip the value comes from
+	 */
+	void add(const AnimationPlayback::Target& target, AnimTrackType type, const float* value, float weight, AnimationPlayback::Applier applier, const AnimationClip* clip);
+
+	/**
+	 Writes the properties added since the last call. A property whose weights add up to 1 or more is their weighted
+	 average; under 1, what is left is taken from the value the node had when the property started being blended
+	 (read once, not what the blend wrote since). Active and SpriteFrame cannot be mixed and take the value with the
+	 most weight.
+	 */
+	void apply();
+
+private:
+	static const size_t kTypeCount = static_cast<size_t>(AnimTrackType::Count);
+
+	// Sums of one node
+	struct Entry
+	{
+		AnimationPlayback::Target target;
+		// Bit per AnimTrackType added since the last apply
+		uint32_t types = 0;
+		// Per type, the sum of the weighted values and of the weights
+		float values[kTypeCount * 3];
+		float weights[kTypeCount];
+		// Per type, the node's value from before it was blended, and whether it has been read (bit per type). A type
+		// left out of a frame's blend is read again when it comes back.
+		float bases[kTypeCount * 3];
+		uint32_t baseTypes = 0;
+		// Per type, its setter and the clip of the value stepped types take
+		AnimationPlayback::Applier appliers[kTypeCount];
+		const AnimationClip* clips[kTypeCount];
+	};
+
+	// Entries by node, kept for nodes blended before. Idle ones are dropped when there are many of them.
+	std::vector<Entry> _entries;
+	std::unordered_map<cocos2d::Node*, size_t> _indices;
+
+	// Entries added to since the last apply, in the order they were first added to
+	std::vector<size_t> _pending;
+};
+
+NS_CCR_END
@@ -24,8 +24,91 @@
 
 #include "AnimationClip.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+// Keys stepped over from the cursor before giving up and binary searching (a seek or a large dt)
+const int kMaxCursorSteps = 4;
+
+// -1: invalid index
+// -2: haven't reached first frame, so it should be the same as first frame
+// `cursor` is the index returned for this track last time. Playback moves it by a key or two per frame, forwards
+// or backwards (reverse and pingpong), so it is stepped from there and only binary searched on jumps.
+int getValidIndex(const float* times, int len, float elapsed, int& cursor)
+{
+	if (len == 0)
+		return -1;
+
+	if (times[0] > elapsed)
+	{
+		cursor = 0;
+		return -2;
+	}
+
+	if (times[len - 1] <= elapsed)
+	{
+		cursor = len - 1;
+		return len - 1;
+	}
+
+	// From here on times[0] <= elapsed < times[len - 1], so the answer is in [0, len - 2]
+	int i = std::min(std::max(cursor, 0), len - 2);
+	if (times[i] <= elapsed)
+	{
+		for (int step = 0; step < kMaxCursorSteps; ++step, ++i)
+		{
+			if (times[i + 1] > elapsed)
+				return cursor = i;
+		}
+	}
+	else
+	{
+		for (int step = 0; step < kMaxCursorSteps && i > 0; ++step)
+		{
+			if (times[--i] <= elapsed)
+				return cursor = i;
+		}
+	}
+
+	return cursor = static_cast<int>(std::upper_bound(times, times + len, elapsed) - times) - 1;
+}
+
+// Key of a curve in AnimationClip::_curveIndices: its easing followed by the bytes of its control points
+std::string getCurveKey(creator::Easing::Type easing, const std::vector<float>& data)
+{
+	std::string key(sizeof(easing) + data.size() * sizeof(float), '\0');
+	std::memcpy(&key[0], &easing, sizeof(easing));
+	if (!data.empty())
+		std::memcpy(&key[sizeof(easing)], data.data(), data.size() * sizeof(float));
+
+	return key;
+}
+
+float getPercent(const creator::AnimCurve& curve, float start, float end, float elapsed)
+{
+	auto ratio = (elapsed - start) / (end - start);
+
+	if (curve.easing != creator::Easing::Type::Linear)
+	{
+		ratio = creator::Easing::evaluate(curve.easing, ratio);
+	}
+	if (!curve.data.empty())
+	{
+		ratio = curve.bezier.evaluate(ratio);
+	}
+
+	return ratio;
+}
+} // namespace
+
 USING_NS_CCR;
 
+const uint32_t AnimationClip::kNotBaked;
+
 AnimationClip* AnimationClip::create()
 {
 	auto animClip = new (std::nothrow) AnimationClip;
@@ -53,10 +136,19 @@ AnimationClip* AnimationClip::clone()
 	animClip->setName(_name);
 	animClip->setWrapMode(_wrapMode);
 
-	for (const auto& properties : _animPropertiesVec)
-	{
-		animClip->addAnimProperties(properties);
-	}
+	animClip->_trackSets = _trackSets;
+	animClip->_tracks = _tracks;
+	animClip->_times = _times;
+	animClip->_values = _values;
+	animClip->_keyCurves = _keyCurves;
+	animClip->_curves = _curves;
+	animClip->_strings = _strings;
+	animClip->_events = _events;
+
+	animClip->_bakedOffsets = _bakedOffsets;
+	animClip->_bakedValues = _bakedValues;
+	animClip->_bakeStep = _bakeStep;
+	animClip->_bakedSampleCount = _bakedSampleCount;
 
 	// It will be released in the on end event
 	// animClip->retain();
@@ -69,7 +161,11 @@ AnimationClip::AnimationClip() :
 	_sample(0),
 	_duration(0),
 	_wrapMode(WrapMode::Default),
-	_onEnd(nullptr)
+	_onEnd(nullptr),
+	_curves(1, AnimCurve{Easing::Type::Linear, {}}),
+	_bakeStep(0),
+	_bakedSampleCount(0),
+	_currentTrack(-1)
 {
 }
 
@@ -127,12 +223,240 @@ creator::AnimationClip::WrapMode AnimationClip::getWrapMode() const
 	return _wrapMode;
 }
 
-void AnimationClip::addAnimProperties(const AnimProperties& properties)
+void AnimationClip::reserve(size_t trackSetCount, size_t trackCount, size_t keyCount, size_t valueCount)
+{
+	_trackSets.reserve(_trackSets.size() + trackSetCount);
+	_tracks.reserve(_tracks.size() + trackCount);
+	_times.reserve(_times.size() + keyCount);
+	_keyCurves.reserve(_keyCurves.size() + keyCount);
+	_values.reserve(_values.size() + valueCount);
+}
+
+void AnimationClip::addTrackSet(const std::string& path)
+{
+	_trackSets.push_back({path, static_cast<uint32_t>(_tracks.size()), 0});
+	_currentTrack = -1;
+}
+
+void AnimationClip::addKey(AnimTrackType type, float frame, const float* value, const std::string& curveType, const std::vector<float>& curveData)
+{
+	CCASSERT(!_trackSets.empty(), "[AnimationClip.addKey]: addTrackSet has to be called first");
+
+	const uint8_t components = getComponentCount(type);
+	if (_currentTrack < 0 || _tracks[_currentTrack].type != type)
+	{
+		AnimTrackSet& trackSet = _trackSets.back();
+		AnimTrack track = {type, components, static_cast<uint32_t>(_times.size()), 0, static_cast<uint32_t>(_values.size())};
+
+		// Keep the tracks of a set sorted by type, that's the order they are applied in
+		auto it = std::upper_bound(_tracks.begin() + trackSet.firstTrack, _tracks.end(), type, [](AnimTrackType type, const AnimTrack& track) {
+			return type < track.type;
+		});
+
+		_currentTrack = static_cast<int>(it - _tracks.begin());
+		_tracks.insert(it, track);
+		++trackSet.trackCount;
+	}
+
+	++_tracks[_currentTrack].keyCount;
+	_times.push_back(frame);
+	_values.insert(_values.end(), value, value + components);
+	_keyCurves.push_back(this->addCurve(curveType, curveData));
+}
+
+void AnimationClip::addKey(AnimTrackType type, float frame, const std::string& value, const std::string& curveType, const std::vector<float>& curveData)
 {
-	_animPropertiesVec.push_back(properties);
+	if (_stringIndices.size() != _strings.size())
+	{
+		_stringIndices.clear();
+		for (size_t i = 0; i < _strings.size(); ++i)
+		{
+			_stringIndices.emplace(_strings[i], static_cast<uint32_t>(i));
+		}
+	}
+
+	auto result = _stringIndices.emplace(value, static_cast<uint32_t>(_strings.size()));
+	if (result.second)
+		_strings.push_back(value);
+
+	const float index = static_cast<float>(result.first->second);
+	this->addKey(type, frame, &index, curveType, curveData);
+}
+
+void AnimationClip::endKeys()
+{
+	std::unordered_map<std::string, uint16_t>().swap(_curveIndices);
+	std::unordered_map<std::string, uint32_t>().swap(_stringIndices);
+}
+
+void AnimationClip::addEvent(float time, const std::string& func, const std::vector<std::string>& params)
+{
+	auto it = std::upper_bound(_events.begin(), _events.end(), time, [](float time, const AnimEvent& event) {
+		return time < event.time;
+	});
+
+	_events.insert(it, AnimEvent{time, func, params});
 }
 
-const std::vector<AnimProperties>& AnimationClip::getAnimProperties() const
+uint16_t AnimationClip::addCurve(const std::string& type, const std::vector<float>& data)
 {
-	return _animPropertiesVec;
+	// Resolve the name once here, playback only switches on the type
+	const Easing::Type easing = Easing::getType(type);
+
+	if (_curveIndices.size() != _curves.size())
+	{
+		_curveIndices.clear();
+		for (size_t i = 0; i < _curves.size(); ++i)
+		{
+			_curveIndices.emplace(getCurveKey(_curves[i].easing, _curves[i].data), static_cast<uint16_t>(i));
+		}
+	}
+
+	auto it = _curveIndices.find(getCurveKey(easing, data));
+	if (it != _curveIndices.end())
+		return it->second;
+
+	// Key curve indices are 16 bits, clips never come close to that many distinct easings
+	if (_curves.size() > std::numeric_limits<uint16_t>::max())
+	{
+		CCASSERT(false, "[AnimationClip.addCurve]: too many curves in a clip");
+		CCLOG("[AnimationClip.addCurve]: too many curves in %s, using a linear one", _name.c_str());
+		return 0;
+	}
+
+	const uint16_t index = static_cast<uint16_t>(_curves.size());
+	_curves.push_back(AnimCurve{easing, data, data.empty() ? Bazier::Evaluator() : Bazier::Evaluator(data)});
+	_curveIndices.emplace(getCurveKey(easing, data), index);
+	return index;
+}
+
+uint8_t AnimationClip::getComponentCount(AnimTrackType type)
+{
+	switch (type)
+	{
+	case AnimTrackType::Position:
+		return 2;
+	case AnimTrackType::Color:
+		return 3;
+	default:
+		return 1;
+	}
+}
+
+bool AnimationClip::isStepped(AnimTrackType type)
+{
+	return type == AnimTrackType::Active || type == AnimTrackType::SpriteFrame;
+}
+
+void AnimationClip::getStepSpan(const AnimTrack& track, float elapsed, int cursor, float& from, float& until) const
+{
+	const float* times = _times.data() + track.firstKey;
+	const int keyCount = static_cast<int>(track.keyCount);
+
+	if (keyCount == 0)
+	{
+		from = -std::numeric_limits<float>::infinity();
+		until = std::numeric_limits<float>::infinity();
+	}
+	else if (elapsed < times[0])
+	{
+		from = -std::numeric_limits<float>::infinity();
+		until = times[0];
+	}
+	else
+	{
+		from = times[cursor];
+		until = cursor + 1 < keyCount ? times[cursor + 1] : std::numeric_limits<float>::infinity();
+	}
+}
+
+void AnimationClip::bake(float sampleRate)
+{
+	if (sampleRate == 0)
+		sampleRate = _sample;
+
+	_bakedOffsets.clear();
+	_bakedValues.clear();
+	_bakeStep = 0;
+	_bakedSampleCount = 0;
+
+	if (sampleRate <= 0 || _duration <= 0)
+		return;
+
+	// Samples are spread evenly over [0, duration], so that the last one lands on the end of the clip
+	const uint32_t sampleCount = std::max(2u, static_cast<uint32_t>(std::ceil(_duration * sampleRate)) + 1);
+	const float step = _duration / (sampleCount - 1);
+
+	_bakedOffsets.assign(_tracks.size(), kNotBaked);
+	for (size_t i = 0; i < _tracks.size(); ++i)
+	{
+		const AnimTrack& track = _tracks[i];
+		if (isStepped(track.type))
+			continue;
+
+		_bakedOffsets[i] = static_cast<uint32_t>(_bakedValues.size());
+		_bakedValues.resize(_bakedValues.size() + sampleCount * track.components);
+
+		int cursor = 0;
+		float* out = _bakedValues.data() + _bakedOffsets[i];
+		for (uint32_t sample = 0; sample < sampleCount; ++sample, out += track.components)
+		{
+			this->evaluateKeys(track, std::min(sample * step, _duration), cursor, out);
+		}
+	}
+
+	_bakeStep = step;
+	_bakedSampleCount = sampleCount;
+}
+
+void AnimationClip::evaluate(const AnimTrack& track, float elapsed, int& cursor, float* out) const
+{
+	const uint32_t offset = _bakeStep > 0 ? _bakedOffsets[&track - _tracks.data()] : kNotBaked;
+	if (offset == kNotBaked)
+	{
+		this->evaluateKeys(track, elapsed, cursor, out);
+		return;
+	}
+
+	const float position = std::min(std::max(elapsed, 0.f), _duration) / _bakeStep;
+	const uint32_t index = std::min(static_cast<uint32_t>(position), _bakedSampleCount - 2);
+	const float percent = std::min(position - index, 1.f);
+
+	const float* value = _bakedValues.data() + offset + index * track.components;
+	const float* nextValue = value + track.components;
+	for (int i = 0; i < track.components; ++i)
+	{
+		out[i] = value[i] + percent * (nextValue[i] - value[i]);
+	}
+}
+
+void AnimationClip::evaluateKeys(const AnimTrack& track, float elapsed, int& cursor, float* out) const
+{
+	const float* times = _times.data() + track.firstKey;
+	const float* values = _values.data() + track.firstValue;
+	const int keyCount = static_cast<int>(track.keyCount);
+	const int components = track.components;
+
+	const int index = getValidIndex(times, keyCount, elapsed, cursor);
+	if (index == -2)
+	{
+		std::copy(values, values + components, out);
+		return;
+	}
+
+	const float* value = values + index * components;
+	if (index == keyCount - 1 || isStepped(track.type))
+	{
+		std::copy(value, value + components, out);
+		return;
+	}
+
+	const auto& curve = _curves[_keyCurves[track.firstKey + index]];
+	const float percent = getPercent(curve, times[index], times[index + 1], elapsed);
+
+	const float* nextValue = value + components;
+	for (int i = 0; i < components; ++i)
+	{
+		out[i] = value[i] + percent * (nextValue[i] - value[i]);
+	}
 }
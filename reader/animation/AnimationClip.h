@@ -24,6 +24,7 @@
 #pragma once
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <functional>
 
@@ -72,22 +73,108 @@ public:
 	void setWrapMode(WrapMode wrapMode);
 	WrapMode getWrapMode() const;
 
+	// Not called by playback, end callbacks are given to AnimationManager::playAnimationClip for each play
 	inline void setOnEndCallback(const AnimationClipEndCallback& onEnd) { _onEnd = onEnd; }
 	inline AnimationClipEndCallback getOnEndCallback() const { return _onEnd; }
 
-	void addAnimProperties(const AnimProperties& properties);
-	const std::vector<AnimProperties>& getAnimProperties() const;
+	// Sizes the clip's arrays for the keys about to be added, so they are allocated once rather than grown
+	void reserve(size_t trackSetCount, size_t trackCount, size_t keyCount, size_t valueCount);
+
+	// Starts the tracks of the node at `path`, keys added afterwards belong to it
+	void addTrackSet(const std::string& path);
+
+	/**
+	 Appends a key to the track of `type` in the current track set. The keys of a track have to be added one after another, in time order.
+	 @param value	`AnimTrack::components` floats (see getComponentCount)
+	 */
+	void addKey(AnimTrackType type, float frame, const float* value, const std::string& curveType, const std::vector<float>& curveData);
+	// Same as above, for SpriteFrame tracks
+	void addKey(AnimTrackType type, float frame, const std::string& value, const std::string& curveType, const std::vector<float>& curveData);
+
+	// Drops the lookups addKey shares curves and strings with, once all keys are added. They are rebuilt if more keys come.
+	void endKeys();
+
+	// Inserts an event, keeping them sorted by time. Events at the same time fire in the order they were added.
+	void addEvent(float time, const std::string& func, const std::vector<std::string>& params);
+	inline const std::vector<AnimEvent>& getEvents() const { return _events; }
+
+	inline const std::vector<AnimTrackSet>& getTrackSets() const { return _trackSets; }
+	inline const std::vector<AnimTrack>& getTracks() const { return _tracks; }
+	inline const std::vector<float>& getTimes() const { return _times; }
+	inline const std::vector<float>& getValues() const { return _values; }
+	inline const std::vector<uint16_t>& getKeyCurves() const { return _keyCurves; }
+	inline const std::vector<AnimCurve>& getCurves() const { return _curves; }
+	inline const std::string& getString(size_t index) const { return _strings[index]; }
+
+	static uint8_t getComponentCount(AnimTrackType type);
+
+	// Active and SpriteFrame keys hold their value until the next key
+	static bool isStepped(AnimTrackType type);
+
+	/**
+	 Writes the `track.components` floats of the track's value at `elapsed` to `out`
+	 @param cursor	Keyframe cursor of the track, kept by the caller between calls (see AnimationPlayback)
+	 */
+	void evaluate(const AnimTrack& track, float elapsed, int& cursor, float* out) const;
+
+	/**
+	 For a stepped track, the span [from, until) of times around `elapsed` over which it keeps the value evaluate
+	 just gave, so that callers can skip evaluating it until they leave the span
+	 @param cursor	The track's cursor, as evaluate left it for `elapsed`
+	 */
+	void getStepSpan(const AnimTrack& track, float elapsed, int cursor, float& from, float& until) const;
+
+	/**
+	 Samples every track at `sampleRate` samples per second (the clip's own sample rate if 0) into dense arrays.
+	 Playback then only interpolates between two neighbouring samples instead of searching keys and solving easings
+	 and curves, at the cost of duration * sampleRate floats per animated value. Active and SpriteFrame tracks only
+	 switch on keys and are left as they are. Baking again replaces the samples, a negative rate drops them.
+	 */
+	void bake(float sampleRate = 0);
+	inline bool isBaked() const { return _bakeStep > 0; }
 
 private:
+	friend class AnimationClipCache;
+
 	AnimationClip();
 
+	uint16_t addCurve(const std::string& type, const std::vector<float>& data);
+	void evaluateKeys(const AnimTrack& track, float elapsed, int& cursor, float* out) const;
+
 	std::string _name;
 	float _duration;
 	float _sample;
 	float _speed;
 	WrapMode _wrapMode;
-	std::vector<AnimProperties> _animPropertiesVec;
 	AnimationClipEndCallback _onEnd;
+
+	// Packed keys, see AnimTrack. Only tracks that have keys are stored.
+	std::vector<AnimTrackSet> _trackSets;
+	std::vector<AnimTrack> _tracks;
+	std::vector<float> _times;
+	std::vector<float> _values;
+	// Per key, index into _curves of the easing towards the next key
+	std::vector<uint16_t> _keyCurves;
+	// Shared easings, the first one is linear
+	std::vector<AnimCurve> _curves;
+	// Values of SpriteFrame keys
+	std::vector<std::string> _strings;
+	// Sorted by time
+	std::vector<AnimEvent> _events;
+
+	// Indices into _curves (by easing and control points) and _strings, while keys are added
+	std::unordered_map<std::string, uint16_t> _curveIndices;
+	std::unordered_map<std::string, uint32_t> _stringIndices;
+
+	// Baked samples, see bake. Per track, the index of its first sample in _bakedValues or kNotBaked.
+	static const uint32_t kNotBaked = UINT32_MAX;
+	std::vector<uint32_t> _bakedOffsets;
+	std::vector<float> _bakedValues;
+	float _bakeStep;
+	uint32_t _bakedSampleCount;
+
+	// Track keys are currently added to, -1 if none
+	int _currentTrack;
 };
 
 NS_CCR_END
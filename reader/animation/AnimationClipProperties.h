@@ -25,159 +25,82 @@
 
 #include "../Macros.h"
 #include "cocos2d.h"
+#include "Easing.h"
+#include "Bezier.h"
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
 NS_CCR_BEGIN
 
-struct AnimPropRotation
+// Node properties an animation can drive. Tracks of a node are applied in this order.
+enum class AnimTrackType : uint8_t
 {
-	float frame;
-	float value;
-	std::vector<float> curveData;
-	std::string curveType;
+	Position,
+	Color,
+	ScaleX,
+	ScaleY,
+	Rotation,
+	SkewX,
+	SkewY,
+	Opacity,
+	AnchorX,
+	AnchorY,
+	PositionX,
+	PositionY,
+	Active,
+	Width,
+	Height,
+	SpriteFrame,
+	Count
 };
 
-struct AnimPropPosition
+// Easing of the segment starting at a key. Keys with the same easing share one entry of the clip's curve table.
+struct AnimCurve
 {
-	float frame;
-	cocos2d::Vec2 value;
-	std::vector<float> curveData;
-	std::string curveType;
-};
+	Easing::Type easing;
 
-struct AnimPropPositionX
-{
-	float frame;
-	float value;
-	std::vector<float> curveData;
-	std::string curveType;
-};
+	// Control points of a bezier curve, empty if the segment has none
+	std::vector<float> data;
 
-struct AnimPropPositionY
-{
-	float frame;
-	float value;
-	std::vector<float> curveData;
-	std::string curveType;
+	// Built from `data` when the clip is loaded
+	Bazier::Evaluator bezier;
 };
 
-struct AnimPropScaleX
+// Keys of one property, stored as a slice of the clip's packed arrays.
+// Values are floats: Vec2 and Color3B use 2 and 3 of them per key, Active is 0/1,
+// and SpriteFrame is an index into the clip's string table.
+struct AnimTrack
 {
-	float frame;
-	float value;
-	std::vector<float> curveData;
-	std::string curveType;
-};
+	AnimTrackType type;
 
-struct AnimPropScaleY
-{
-	float frame;
-	float value;
-	std::vector<float> curveData;
-	std::string curveType;
-};
+	// Floats per key value
+	uint8_t components;
 
-struct AnimPropWidth
-{
-	float frame;
-	float value;
-	std::vector<float> curveData;
-	std::string curveType;
-};
+	// Index of the first key in the clip's times/curve indices, and the number of keys
+	uint32_t firstKey;
+	uint32_t keyCount;
 
-struct AnimPropHeight
-{
-	float frame;
-	float value;
-	std::vector<float> curveData;
-	std::string curveType;
-};
-
-struct AnimPropColor
-{
-	float frame;
-	cocos2d::Color3B value;
-	std::vector<float> curveData;
-	std::string curveType;
+	// Index of the first float in the clip's values
+	uint32_t firstValue;
 };
 
-struct AnimPropOpacity
+// The tracks animating the node at `path` (relative to the animated node, empty for the node itself)
+struct AnimTrackSet
 {
-	float frame;
-	float value;
-	std::vector<float> curveData;
-	std::string curveType;
-};
-
-struct AnimPropAnchorX
-{
-	float frame;
-	float value;
-	std::vector<float> curveData;
-	std::string curveType;
-};
-
-struct AnimPropAnchorY
-{
-	float frame;
-	float value;
-	std::vector<float> curveData;
-	std::string curveType;
-};
-
-struct AnimPropSkewX
-{
-	float frame;
-	float value;
-	std::vector<float> curveData;
-	std::string curveType;
-};
-
-struct AnimPropSkewY
-{
-	float frame;
-	float value;
-	std::vector<float> curveData;
-	std::string curveType;
-};
-
-struct AnimPropActive
-{
-	float frame;
-	bool value;
-	std::vector<float> curveData;
-	std::string curveType;
-};
-
-struct AnimPropSpriteFrame
-{
-	float frame;
-	std::string value;
-	std::vector<float> curveData;
-	std::string curveType;
+	std::string path;
+	uint32_t firstTrack;
+	uint32_t trackCount;
 };
 
-struct AnimProperties
+// A call made when playback crosses `time` (in seconds, like key frames). Creator names a component method and its
+// arguments, it is up to the event callback to act on them.
+struct AnimEvent
 {
-	std::vector<AnimPropRotation> animRotation;
-	std::vector<AnimPropPosition> animPosition;
-	std::vector<AnimPropPositionX> animPositionX;
-	std::vector<AnimPropPositionY> animPositionY;
-	std::vector<AnimPropScaleX> animScaleX;
-	std::vector<AnimPropScaleY> animScaleY;
-	std::vector<AnimPropSkewX> animSkewX;
-	std::vector<AnimPropSkewY> animSkewY;
-	std::vector<AnimPropAnchorX> animAnchorX;
-	std::vector<AnimPropAnchorY> animAnchorY;
-	std::vector<AnimPropColor> animColor;
-	std::vector<AnimPropOpacity> animOpacity;
-	std::vector<AnimPropWidth> animWidth;
-	std::vector<AnimPropHeight> animHeight;
-	std::vector<AnimPropActive> animActive;
-	std::vector<AnimPropSpriteFrame> animSpriteFrame;
-	std::string path;
+	float time;
+	std::string func;
+	std::vector<std::string> params;
 };
 
 NS_CCR_END
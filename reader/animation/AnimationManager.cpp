@@ -2,15 +2,48 @@
 
 #include "AnimateClip.h"
 
+#include "../core/WorkerPool.h"
+
+#include <algorithm>
+#include <cmath>
+
 NS_CCR_BEGIN
 
-AnimationManager::AnimationManager()
+namespace
+{
+const char* const kTickKey = "AnimationManager";
+
+// Running clips needed before they are evaluated on worker threads, and how many of them a worker takes at once
+const size_t kMinParallelPlaybacks = 64;
+const size_t kPlaybacksPerJob = 16;
+}
+
+AnimationManager::AnimationManager() :
+	m_PlaybacksSorted(true),
+	m_Ticking(false),
+	m_NextPlaybackId(0),
+	m_TimeScale(1),
+	m_GroupTimeScales(1, 1.f),
+	m_FixedTimeStep(0),
+	m_StepTime(0),
+	m_Culling(Culling::None),
+	m_CulledInterval(-1),
+	m_QuantizedEvaluation(false),
+	m_EvaluationThreads(0),
+	m_Workers(nullptr)
 {
 	this->setName("AnimationManager");
+
+	// Scheduled against the playback array rather than this node: the manager is added to the first scene it is
+	// loaded with, and that scene pausing its children on exit must not stop clips running on other scenes.
+	cocos2d::Director::getInstance()->getScheduler()->schedule([this](float dt) { this->tick(dt); }, &m_Playbacks, 0, false, kTickKey);
 }
 
 AnimationManager::~AnimationManager()
 {
+	cocos2d::Director::getInstance()->getScheduler()->unschedule(kTickKey, &m_Playbacks);
+	delete m_Workers;
+
 	// 	for (auto&& animationInfo : _animations)
 	// 	{
 	// //		animationInfo.target->release();
@@ -21,6 +54,11 @@ void AnimationManager::addAnimation(const AnimationInfo& animationInfo)
 {
 	//	animationInfo.target->retain();
 	m_Animations.push_back(animationInfo);
+
+	for (auto& animClip : animationInfo.clips)
+	{
+		m_ClipsByName.emplace(animClip->getName(), animClip);
+	}
 }
 
 void AnimationManager::playOnLoad()
@@ -54,20 +92,8 @@ void AnimationManager::stopAnimationClipsRunByPlayOnLoad()
 
 AnimationClip* AnimationManager::getAnimationClip(const std::string& animationClipName)
 {
-	bool foundAnimationClip = false;
-
-	for (auto& animationInfo : m_Animations)
-	{
-		for (auto& animClip : animationInfo.clips)
-		{
-			if (animClip->getName() == animationClipName)
-			{
-				return animClip->clone();
-			}
-		}
-	}
-
-	return nullptr;
+	auto it = m_ClipsByName.find(animationClipName);
+	return it != m_ClipsByName.end() ? it->second : nullptr;
 }
 
 void AnimationManager::playAnimationClip(cocos2d::Node* target, const std::string& animationClipName, const std::function<void()>& onEnd)
@@ -90,134 +116,580 @@ void AnimationManager::playAnimationClip(cocos2d::Node* target, AnimationClip* c
 
 void AnimationManager::stopAnimationClip(cocos2d::Node* target, AnimationClip* clip, bool callClipEndCallback)
 {
-	for (auto&& e : m_CachedAnimates)
+	auto playback = this->findPlayback(target, clip);
+	if (playback)
+		this->stopPlayback(playback->getId(), callClipEndCallback);
+}
+
+void AnimationManager::stopAnimationClip(cocos2d::Node* target, const std::string& animationClipName, bool callClipEndCallback)
+{
+	auto playback = this->findPlayback(target, this->getAnimationClip(animationClipName));
+	if (playback)
+		this->stopPlayback(playback->getId(), callClipEndCallback);
+}
+
+void AnimationManager::pauseAnimationClip(cocos2d::Node* target, const std::string& animationClipName)
+{
+	auto playback = this->findPlayback(target, this->getAnimationClip(animationClipName));
+	if (playback)
+		playback->setPaused(true);
+}
+
+void AnimationManager::resumeAnimationClip(cocos2d::Node* target, const std::string& animationClipName)
+{
+	auto playback = this->findPlayback(target, this->getAnimationClip(animationClipName));
+	if (playback)
+		playback->setPaused(false);
+}
+
+void AnimationManager::runAnimationClip(cocos2d::Node* target, AnimationClip* animationClip, const std::function<void()>& onEnd)
+{
+	this->startPlayback(target, animationClip, onEnd, nullptr);
+}
+
+AnimateClip* AnimationManager::getAnimateClip(cocos2d::Node* target, const std::string& animationClipName)
+{
+	auto playback = this->findPlayback(target, this->getAnimationClip(animationClipName));
+	if (!playback)
+		return nullptr;
+
+	// Clips played through the manager get a node only when one is asked for
+	if (!playback->getWrapper())
 	{
-		auto animator = std::get<2>(e);
-		if (std::get<0>(e) == target && animator->getClip() == clip)
-		{
-			if (!callClipEndCallback)
-			{
-				clip->setOnEndCallback(nullptr);
-			}
+		auto animateClip = AnimateClip::createWithAnimationClip(target, playback->getClip());
+		animateClip->_endCallback = playback->getEndCallback();
+		animateClip->_eventCallback = playback->getEventCallback();
+		animateClip->_speed = playback->getSpeed();
+		animateClip->_wrapMode = playback->getWrapMode();
+		animateClip->_manager = this;
+		animateClip->_playbackId = playback->getId();
+		this->retain();
 
-			animator->stopAnimate();
-			break;
-		}
+		playback->setWrapper(animateClip);
 	}
+
+	return playback->getWrapper();
 }
 
-void AnimationManager::stopAnimationClip(cocos2d::Node* target, const std::string& animationClipName, bool callClipEndCallback)
+void AnimationManager::crossFade(cocos2d::Node* target, const std::string& animationClipName, float duration, const std::function<void()>& onEnd)
 {
-	auto animateClip = getAnimateClip(target, animationClipName);
-	if (animateClip)
+	auto clip = this->getAnimationClip(animationClipName);
+	if (!clip)
 	{
-		if (!callClipEndCallback)
-		{
-			animateClip->getClip()->setOnEndCallback(nullptr);
-		}
+		CCLOG("Animation clip not found %s", animationClipName.c_str());
+		return;
+	}
 
-		animateClip->stopAnimate();
+	for (auto& playback : m_Playbacks)
+	{
+		if (!playback.isStopped() && playback.getRootTarget() == target)
+			playback.fadeTo(0, duration, true);
 	}
+
+	const uint32_t id = this->startPlayback(target, clip, onEnd, nullptr);
+	auto playback = this->findPlayback(id);
+	playback->setWeight(0);
+	playback->fadeTo(1, duration, false);
 }
 
-void AnimationManager::pauseAnimationClip(cocos2d::Node* target, const std::string& animationClipName)
+void AnimationManager::setAnimationClipWeight(cocos2d::Node* target, const std::string& animationClipName, float weight, float duration)
 {
-	auto animateClip = getAnimateClip(target, animationClipName);
-	if (animateClip)
-		animateClip->pauseAnimate();
+	auto playback = this->findPlayback(target, this->getAnimationClip(animationClipName));
+	if (playback)
+		playback->fadeTo(weight, duration, false);
 }
 
-void AnimationManager::resumeAnimationClip(cocos2d::Node* target, const std::string& animationClipName)
+void AnimationManager::seekAnimationClip(cocos2d::Node* target, const std::string& animationClipName, float time)
 {
-	auto animateClip = getAnimateClip(target, animationClipName);
-	if (animateClip)
-		animateClip->resumeAnimate();
+	auto playback = this->findPlayback(target, this->getAnimationClip(animationClipName));
+	if (!playback)
+		return;
+
+	const uint32_t id = playback->getId();
+	playback->seek(time);
+
+	// Evaluated where it now is, without moving on
+	const bool running = playback->evaluate(0);
+	this->applyPlayback(*playback);
+
+	if (!m_Ticking)
+		m_Blender.apply();
+
+	if (!running)
+		this->stopPlayback(id, true);
 }
 
-void AnimationManager::runAnimationClip(cocos2d::Node* target, AnimationClip* animationClip, const std::function<void()>& onEnd)
+void AnimationManager::setTimeScale(float scale)
+{
+	m_TimeScale = scale;
+}
+
+void AnimationManager::setGroupTimeScale(const std::string& group, float scale)
+{
+	m_GroupTimeScales[this->getGroupId(group)] = scale;
+}
+
+void AnimationManager::setAnimationClipGroup(cocos2d::Node* target, const std::string& animationClipName, const std::string& group)
+{
+	auto playback = this->findPlayback(target, this->getAnimationClip(animationClipName));
+	if (playback)
+		playback->setGroup(this->getGroupId(group));
+}
+
+uint32_t AnimationManager::getGroupId(const std::string& group)
+{
+	auto it = m_GroupIds.find(group);
+	if (it != m_GroupIds.end())
+		return it->second;
+
+	const uint32_t id = static_cast<uint32_t>(m_GroupTimeScales.size());
+	m_GroupIds.emplace(group, id);
+	m_GroupTimeScales.push_back(1);
+	return id;
+}
+
+void AnimationManager::setFixedTimeStep(float step)
 {
-	animationClip->setOnEndCallback(onEnd);
-	auto animateClip = AnimateClip::createWithAnimationClip(target, animationClip);
-	animateClip->retain();
+	m_FixedTimeStep = step;
+	m_StepTime = 0;
+}
+
+void AnimationManager::advance(float time)
+{
+	this->tick(time);
+}
+
+uint32_t AnimationManager::startPlayback(cocos2d::Node* target, AnimationClip* clip, const AnimationPlayback::EndCallback& onEnd, AnimateClip* wrapper)
+{
+	const uint32_t id = ++m_NextPlaybackId;
+	m_Playbacks.emplace_back(id, target, clip, onEnd);
+	m_Playbacks.back().setWrapper(wrapper);
+	m_Playbacks.back().setQuantized(m_QuantizedEvaluation);
+
+	m_PlaybackIndices[id] = m_Playbacks.size() - 1;
+	m_PlaybacksByTarget.emplace(PlaybackKey(target, clip), id);
+
+	if (m_Playbacks.size() > 1 && m_Playbacks[m_Playbacks.size() - 2].getClip() > clip)
+		m_PlaybacksSorted = false;
+
+	// Released when the playback is removed, so that the manager outlives the clips it runs
 	this->retain();
 
-	animateClip->setCallbackForEndevent([=]() {
-		// If there is an on end function supplied, run it
-		auto callback = animationClip->getOnEndCallback();
-		if (callback)
-		{
-			callback();
-		}
+	return id;
+}
 
-		CCLOG("Removing animation clip %s from memory", animationClip->getName().c_str());
-		this->removeAnimateClip(target, animationClip->getName());
+void AnimationManager::stopPlayback(uint32_t id, bool callEndCallback)
+{
+	auto playback = this->findPlayback(id);
+	if (!playback)
+		return;
 
-		this->release();
-	});
+	if (!callEndCallback)
+		playback->setEndCallback(nullptr);
 
-	animateClip->startAnimate();
-	m_CachedAnimates.emplace_back(target, animationClip->getName(), animateClip);
+	this->stopPlayback(*playback);
+
+	// Stops requested by a target while the tick is applying values get their callback once it is done
+	if (m_Ticking)
+		return;
+
+	// Otherwise it runs right away. The playback keeps the clip and targets alive until the next tick removes it.
+	auto callback = playback->getEndCallback();
+	playback->setEndCallback(nullptr);
+
+	if (callback)
+		callback();
 }
 
-void AnimationManager::removeAnimateClip(cocos2d::Node* target, const std::string& animationClipName)
+void AnimationManager::stopPlayback(AnimationPlayback& playback)
 {
-	for (auto iter = m_CachedAnimates.begin(), end = m_CachedAnimates.end(); iter != end; ++iter)
+	playback.stop();
+
+	auto range = m_PlaybacksByTarget.equal_range(PlaybackKey(playback.getRootTarget(), playback.getClip()));
+	for (auto it = range.first; it != range.second; ++it)
 	{
-		auto&& e = *iter;
-		if (std::get<0>(e) == target && std::get<1>(e) == animationClipName)
+		if (it->second == playback.getId())
 		{
-			m_CachedAnimates.erase(iter);
+			m_PlaybacksByTarget.erase(it);
 			break;
 		}
 	}
 }
 
-AnimateClip* AnimationManager::getAnimateClip(cocos2d::Node* target, const std::string& animationClipName)
+void AnimationManager::pausePlayback(uint32_t id, bool paused)
+{
+	auto playback = this->findPlayback(id);
+	if (playback)
+		playback->setPaused(paused);
+}
+
+void AnimationManager::updatePlayback(uint32_t id, float dt)
 {
-	for (auto&& e : m_CachedAnimates)
+	auto playback = this->findPlayback(id);
+	if (!playback || playback->isPaused())
+		return;
+
+	const bool running = playback->evaluate(dt * m_TimeScale * m_GroupTimeScales[playback->getGroup()]);
+	this->applyPlayback(*playback);
+	this->queueEvents(*playback);
+
+	// The clip's last events come before its end. During the tick, the blend is applied along with the others.
+	if (!m_Ticking)
 	{
-		if (std::get<0>(e) == target && std::get<1>(e) == animationClipName)
-			return std::get<2>(e);
+		m_Blender.apply();
+		this->dispatchEvents();
 	}
 
-	return nullptr;
+	if (!running)
+		this->stopPlayback(id, true);
 }
 
-void AnimationManager::RemoveAllAnimations()
+void AnimationManager::setAnimationEventCallback(const AnimationPlayback::EventCallback& callback)
 {
-	m_Animations.clear();
+	m_EventCallback = callback;
 }
 
-void AnimationManager::RemoveSceneAnimations()
+void AnimationManager::setEvaluationThreads(unsigned int threadCount)
+{
+	m_EvaluationThreads = threadCount;
+
+	// Started again with the new count when next needed
+	delete m_Workers;
+	m_Workers = nullptr;
+}
+
+void AnimationManager::setQuantizedEvaluation(bool quantized)
+{
+	m_QuantizedEvaluation = quantized;
+
+	for (auto& playback : m_Playbacks)
+	{
+		playback.setQuantized(quantized);
+	}
+}
+
+void AnimationManager::setCulling(Culling culling, float interval)
+{
+	m_Culling = culling;
+	m_CulledInterval = interval;
+}
+
+bool AnimationManager::isCulled(cocos2d::Node* target, const cocos2d::Rect& visibleRect) const
+{
+	if (!target->isRunning())
+		return true;
+
+	for (auto node = target; node; node = node->getParent())
+	{
+		if (!node->isVisible())
+			return true;
+	}
+
+	if (m_Culling != Culling::Offscreen)
+		return false;
+
+	const auto& size = target->getContentSize();
+	if (size.width <= 0 || size.height <= 0)
+		return false;
+
+	const auto bounds = cocos2d::RectApplyAffineTransform(cocos2d::Rect(cocos2d::Vec2::ZERO, size), target->getNodeToWorldAffineTransform());
+	return !bounds.intersectsRect(visibleRect);
+}
+
+void AnimationManager::setPlaybackEventCallback(uint32_t id, const AnimationPlayback::EventCallback& onEvent)
+{
+	auto playback = this->findPlayback(id);
+	if (playback)
+		playback->setEventCallback(onEvent);
+}
+
+void AnimationManager::setPlaybackEndCallback(uint32_t id, const AnimationPlayback::EndCallback& onEnd)
 {
-	decltype(m_Animations)::iterator it;
-	for (it = std::begin(m_Animations); it != std::end(m_Animations);)
+	auto playback = this->findPlayback(id);
+	if (playback)
+		playback->setEndCallback(onEnd);
+}
+
+AnimationPlayback* AnimationManager::findPlayback(uint32_t id)
+{
+	auto it = m_PlaybackIndices.find(id);
+	if (it == m_PlaybackIndices.end())
+		return nullptr;
+
+	auto& playback = m_Playbacks[it->second];
+	return playback.isStopped() ? nullptr : &playback;
+}
+
+AnimationPlayback* AnimationManager::findPlayback(cocos2d::Node* target, AnimationClip* clip)
+{
+	// The clip may be playing more than once on the target, the earliest play is the one meant
+	uint32_t id = 0;
+	auto range = m_PlaybacksByTarget.equal_range(PlaybackKey(target, clip));
+	for (auto it = range.first; it != range.second; ++it)
 	{
-		if (it->attachedToScene)
+		if (id == 0 || it->second < id)
+			id = it->second;
+	}
+
+	return id != 0 ? this->findPlayback(id) : nullptr;
+}
+
+void AnimationManager::tick(float dt)
+{
+	if (m_Playbacks.empty())
+		return;
+
+	dt *= m_TimeScale;
+	if (m_FixedTimeStep > 0)
+	{
+		m_StepTime += dt;
+		dt = std::floor(m_StepTime / m_FixedTimeStep) * m_FixedTimeStep;
+		m_StepTime -= dt;
+
+		// Not a whole step yet, nothing moves
+		if (dt <= 0)
+			return;
+	}
+
+	if (!m_PlaybacksSorted)
+	{
+		std::sort(m_Playbacks.begin(), m_Playbacks.end(), [](const AnimationPlayback& a, const AnimationPlayback& b) {
+			return a.getClip() != b.getClip() ? a.getClip() < b.getClip() : a.getId() < b.getId();
+		});
+
+		for (size_t i = 0; i < m_Playbacks.size(); ++i)
 		{
-			it = m_Animations.erase(it);
+			m_PlaybackIndices[m_Playbacks[i].getId()] = i;
+		}
+
+		m_PlaybacksSorted = true;
+	}
+
+	cocos2d::Rect visibleRect;
+	if (m_Culling == Culling::Offscreen)
+	{
+		auto director = cocos2d::Director::getInstance();
+		visibleRect = cocos2d::Rect(director->getVisibleOrigin(), director->getVisibleSize());
+	}
+
+	m_Ticking = true;
+
+	// Culling reads nodes, so it is decided here before anything may run on the workers
+	const size_t count = m_Playbacks.size();
+	m_TickStates.assign(count, TickState::Skip);
+	m_BlendedTargets.clear();
+	for (size_t i = 0; i < count; ++i)
+	{
+		const auto& playback = m_Playbacks[i];
+		if (playback.isPaused() || playback.isStopped())
+			continue;
+
+		const bool culled = m_Culling != Culling::None && this->isCulled(playback.getRootTarget(), visibleRect);
+		m_TickStates[i] = culled ? TickState::Culled : TickState::Update;
+
+		if (playback.isBlended())
+			m_BlendedTargets.push_back(playback.getRootTarget());
+	}
+
+	std::sort(m_BlendedTargets.begin(), m_BlendedTargets.end());
+	m_BlendedTargets.erase(std::unique(m_BlendedTargets.begin(), m_BlendedTargets.end()), m_BlendedTargets.end());
+
+	// Past a few dozen clips, evaluating them (key search, easing, curves) is split over the workers and only the
+	// setters are left to this thread. Below that, waking the workers costs more than it saves.
+	const bool parallel = m_EvaluationThreads != 1 && count >= kMinParallelPlaybacks;
+	if (parallel)
+	{
+		if (!m_Workers)
+			m_Workers = new WorkerPool(m_EvaluationThreads == 0 ? 0 : m_EvaluationThreads - 1);
+
+		m_Workers->Run(count, kPlaybacksPerJob, [this, dt](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i)
+			{
+				auto& state = m_TickStates[i];
+				if (state == TickState::Skip)
+					continue;
+
+				auto& playback = m_Playbacks[i];
+				const float time = dt * m_GroupTimeScales[playback.getGroup()];
+				const bool running = state == TickState::Culled ? playback.evaluateCulled(time, m_CulledInterval) : playback.evaluate(time);
+				if (!running)
+					state = TickState::Ended;
+			}
+		});
+	}
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const auto state = m_TickStates[i];
+		if (state == TickState::Skip)
+			continue;
+
+		auto& playback = m_Playbacks[i];
+		bool running;
+		if (parallel)
+		{
+			running = state != TickState::Ended;
 		}
 		else
 		{
-			++it;
+			const float time = dt * m_GroupTimeScales[playback.getGroup()];
+			running = state == TickState::Culled ? playback.evaluateCulled(time, m_CulledInterval) : playback.evaluate(time);
 		}
+
+		// A target may have stopped it while an earlier clip was applied
+		if (!playback.isStopped())
+			this->applyPlayback(playback);
+
+		this->queueEvents(playback);
+
+		if (!running && !playback.isStopped())
+			this->stopPlayback(playback);
 	}
+
+	// Clips blended on the same nodes write them once, after all of them have been added
+	m_Blender.apply();
+
+	m_Ticking = false;
+
+	// Event and end callbacks run after every clip has been applied, they are free to start or stop clips
+	this->dispatchEvents();
+	this->removeStoppedPlaybacks();
 }
 
-void AnimationManager::RemovePrefabAnimations()
+void AnimationManager::applyPlayback(AnimationPlayback& playback)
 {
-	decltype(m_Animations)::iterator it;
-	for (it = std::begin(m_Animations); it != std::end(m_Animations);)
+	// Every clip on a node being blended goes into the blend, full weight ones included, so none of them is written
+	// over by it
+	if (playback.isBlended() || std::binary_search(m_BlendedTargets.begin(), m_BlendedTargets.end(), playback.getRootTarget()))
+		playback.blend(m_Blender);
+	else
+		playback.apply();
+}
+
+void AnimationManager::removeStoppedPlaybacks()
+{
+	size_t stoppedCount = 0;
+
 	{
-		if (!it->attachedToScene)
+		std::vector<AnimationPlayback> stopped;
+
+		size_t kept = 0;
+		for (size_t i = 0; i < m_Playbacks.size(); ++i)
 		{
-			it = m_Animations.erase(it);
+			if (m_Playbacks[i].isStopped())
+			{
+				m_PlaybackIndices.erase(m_Playbacks[i].getId());
+				stopped.push_back(std::move(m_Playbacks[i]));
+			}
+			else
+			{
+				if (kept != i)
+				{
+					m_Playbacks[kept] = std::move(m_Playbacks[i]);
+					m_PlaybackIndices[m_Playbacks[kept].getId()] = kept;
+				}
+
+				++kept;
+			}
 		}
-		else
+
+		if (stopped.empty())
+			return;
+
+		m_Playbacks.erase(m_Playbacks.begin() + kept, m_Playbacks.end());
+
+		// The playbacks keep their clip, target and node alive until their callbacks returned
+		for (const auto& playback : stopped)
+		{
+			if (playback.getEndCallback())
+				playback.getEndCallback()();
+		}
+
+		stoppedCount = stopped.size();
+	}
+
+	// Last, as it may destroy the manager
+	for (size_t i = 0; i < stoppedCount; ++i)
+	{
+		this->release();
+	}
+}
+
+void AnimationManager::queueEvents(AnimationPlayback& playback)
+{
+	const auto& fired = playback.getFiredEvents();
+	if (fired.empty())
+		return;
+
+	const auto& callback = playback.getEventCallback() ? playback.getEventCallback() : m_EventCallback;
+	if (callback)
+	{
+		const auto& events = playback.getClip()->getEvents();
+		for (uint32_t index : fired)
+		{
+			m_PendingEvents.push_back({callback, playback.getRootTarget(), &events[index]});
+		}
+	}
+
+	playback.clearFiredEvents();
+}
+
+void AnimationManager::dispatchEvents()
+{
+	if (m_PendingEvents.empty())
+		return;
+
+	// Callbacks may update clips themselves and queue more, those run on the next dispatch
+	std::vector<PendingEvent> events;
+	events.swap(m_PendingEvents);
+
+	for (const auto& pending : events)
+	{
+		pending.callback(pending.target, *pending.event);
+	}
+
+	// Keep the capacity for the next tick
+	events.clear();
+	if (m_PendingEvents.empty())
+		m_PendingEvents.swap(events);
+}
+
+void AnimationManager::rebuildClipIndex()
+{
+	m_ClipsByName.clear();
+	for (auto& animationInfo : m_Animations)
+	{
+		for (auto& animClip : animationInfo.clips)
 		{
-			++it;
+			m_ClipsByName.emplace(animClip->getName(), animClip);
 		}
 	}
 }
 
+void AnimationManager::RemoveAllAnimations()
+{
+	m_Animations.clear();
+	m_ClipsByName.clear();
+}
+
+void AnimationManager::RemoveSceneAnimations()
+{
+	auto it = std::remove_if(m_Animations.begin(), m_Animations.end(), [](const AnimationInfo& animationInfo) {
+		return animationInfo.attachedToScene;
+	});
+
+	m_Animations.erase(it, m_Animations.end());
+	this->rebuildClipIndex();
+}
+
+void AnimationManager::RemovePrefabAnimations()
+{
+	auto it = std::remove_if(m_Animations.begin(), m_Animations.end(), [](const AnimationInfo& animationInfo) {
+		return !animationInfo.attachedToScene;
+	});
+
+	m_Animations.erase(it, m_Animations.end());
+	this->rebuildClipIndex();
+}
+
 NS_CCR_END
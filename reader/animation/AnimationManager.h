@@ -23,16 +23,21 @@
  ****************************************************************************/
 #pragma once
 
-#include <tuple>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "../Macros.h"
+#include "AnimationBlender.h"
 #include "AnimationClip.h"
+#include "AnimationPlayback.h"
 
 NS_CCR_BEGIN
 
 class AnimateClip;
+class WorkerPool;
 
 struct AnimationInfo
 {
@@ -45,8 +50,24 @@ struct AnimationInfo
 class AnimationManager : public cocos2d::Node
 {
 public:
+	// Which clips setCulling holds back
+	enum class Culling
+	{
+		None,
+		// The node, or one of its parents, is invisible or not in the running scene
+		Hidden,
+		// Hidden, or its content size lies outside of the visible area. Nodes without a content size are only
+		// culled when hidden, as their children may be anywhere.
+		Offscreen
+	};
+
 	void playAnimationClip(cocos2d::Node* target, const std::string& animationClipName, const std::function<void()>& onEnd = nullptr);
 	void playAnimationClip(cocos2d::Node* target, AnimationClip* clip, const std::function<void()>& onEnd = nullptr);
+
+	/**
+	 @return The clip loaded under that name. It is shared by everything playing it, so clone() it before changing it;
+	 speed and wrap mode can also be changed for a single play through its AnimateClip.
+	 */
 	AnimationClip* getAnimationClip(const std::string& animationClipName);
 
 	// Stopped animations cannot be run again
@@ -56,6 +77,77 @@ public:
 	void resumeAnimationClip(cocos2d::Node* target, const std::string& animationClipName);
 	AnimateClip* getAnimateClip(cocos2d::Node* target, const std::string& animationClipName);
 
+	/**
+	 Starts the clip on the target at weight 0 and fades it in over `duration` seconds, while every other clip playing
+	 on the target fades out and stops once at 0. In between, their values are blended (see setAnimationClipWeight).
+	 A clip already playing on the target is faded out like the others and starts over.
+	 */
+	void crossFade(cocos2d::Node* target, const std::string& animationClipName, float duration, const std::function<void()>& onEnd = nullptr);
+
+	/**
+	 Weight of a clip playing on the target, moved there over `duration` seconds if given. Clips start at 1. Clips
+	 that are under 1 or fading are blended: each property they animate on a node gets the weighted average of
+	 their values, written once per frame, mixed with the value the node had before for what their weights leave
+	 under 1. Clips at full weight on the same target take part in the blend like the others.
+	 */
+	void setAnimationClipWeight(cocos2d::Node* target, const std::string& animationClipName, float weight, float duration = 0);
+
+	/**
+	 Moves a clip playing on the target to `time` seconds into it and applies it there right away, paused or not.
+	 Events in between do not fire. A clip that does not loop ends if moved to its end.
+	 */
+	void seekAnimationClip(cocos2d::Node* target, const std::string& animationClipName, float time);
+
+	/**
+	 Scales the time every clip advances by, 1 by default (0 freezes them). Clips in a group are also scaled by the
+	 group's, which starts at 1 too; a clip is in no group until setAnimationClipGroup.
+	 */
+	void setTimeScale(float scale);
+	inline float getTimeScale() const { return m_TimeScale; }
+	void setGroupTimeScale(const std::string& group, float scale);
+	void setAnimationClipGroup(cocos2d::Node* target, const std::string& animationClipName, const std::string& group);
+
+	/**
+	 Opt-in: clips advance by whole steps of `step` seconds, what is left of a frame carried over to the next one, so
+	 that they go through the same times whatever the frame rate. The steps of a frame are taken as one update.
+	 0 (the default) advances them by the time of each frame. Only the manager's tick and advance are stepped:
+	 AnimateClip::update advances its clip by the time it is given, time scales applied.
+	 */
+	void setFixedTimeStep(float step);
+
+	/**
+	 Advances every running clip by `time` seconds as one more frame would: clips reaching their end end, but each
+	 clip is evaluated and applied once. For catching up after the application was in the background, rather than
+	 replaying every frame missed. Events fire at most once each: a looping clip fires those left in the loop it was
+	 in and those up to where it lands, the events of the whole loops in between are skipped.
+	 */
+	void advance(float time);
+
+	/**
+	 Sets what is called with the events of clips played without a callback of their own (see
+	 AnimateClip::setCallbackForEvent). Events are dispatched once every clip has been applied for the frame.
+	 */
+	void setAnimationEventCallback(const AnimationPlayback::EventCallback& callback);
+
+	/**
+	 Opt-in: evaluates clips at their own sample rate rather than every frame, see AnimationPlayback::setQuantized.
+	 Applies to the clips running and to those started afterwards. Off by default.
+	 */
+	void setQuantizedEvaluation(bool quantized);
+
+	/**
+	 Opt-in: clips whose node is culled keep their time, events and ends, but are only applied every `interval`
+	 seconds, or not at all if negative. They catch up as soon as the node is shown again; those ending while
+	 culled are applied at their end first. Off by default.
+	 */
+	void setCulling(Culling culling, float interval = -1);
+
+	/**
+	 Threads clips are evaluated on once enough of them run, the cocos thread included: 0 (the default) for the number
+	 of hardware threads, 1 to evaluate everything on the cocos thread. Nodes are always written on the cocos thread.
+	 */
+	void setEvaluationThreads(unsigned int threadCount);
+
 	// if a "Play On Load" animation is a loop animation, please stop it manually.
 	void stopAnimationClipsRunByPlayOnLoad();
 	void RemoveAllAnimations();
@@ -74,10 +166,113 @@ private:
 	void playOnLoad(cocos2d::Node* target);
 
 	void runAnimationClip(cocos2d::Node* target, AnimationClip* animationClip, const std::function<void()>& onEnd = nullptr);
-	void removeAnimateClip(cocos2d::Node* target, const std::string& animationClipName);
+
+	// Playbacks, also driven by AnimateClip
+	friend class AnimateClip;
+
+	uint32_t startPlayback(cocos2d::Node* target, AnimationClip* clip, const AnimationPlayback::EndCallback& onEnd, AnimateClip* wrapper);
+	void stopPlayback(uint32_t id, bool callEndCallback);
+	void pausePlayback(uint32_t id, bool paused);
+	void updatePlayback(uint32_t id, float dt);
+	void setPlaybackEndCallback(uint32_t id, const AnimationPlayback::EndCallback& onEnd);
+	void setPlaybackEventCallback(uint32_t id, const AnimationPlayback::EventCallback& onEvent);
+
+	// Skip stopped playbacks
+	AnimationPlayback* findPlayback(uint32_t id);
+	AnimationPlayback* findPlayback(cocos2d::Node* target, AnimationClip* clip);
+
+	// Advances every running playback, scheduled once for the whole manager
+	void tick(float dt);
+
+	// Applies an evaluated playback, or adds it to m_Blender if it is blended
+	void applyPlayback(AnimationPlayback& playback);
+
+	// Id of the group for AnimationPlayback::setGroup, added the first time it is asked for
+	uint32_t getGroupId(const std::string& group);
+
+	// Marks the playback stopped and takes it out of m_PlaybacksByTarget, the tick then removes it
+	void stopPlayback(AnimationPlayback& playback);
+
+	// Drops stopped playbacks, then runs the end callbacks that are left
+	void removeStoppedPlaybacks();
+
+	// Moves the events the playback fired to m_PendingEvents, then calls them once nothing is iterating the playbacks
+	void queueEvents(AnimationPlayback& playback);
+	void dispatchEvents();
+
+	void rebuildClipIndex();
+
+	// Whether the node is culled this frame, visibleRect is only read when culling off-screen nodes
+	bool isCulled(cocos2d::Node* target, const cocos2d::Rect& visibleRect) const;
 
 	std::vector<AnimationInfo> m_Animations;
-	std::vector<std::tuple<cocos2d::Node*, std::string, AnimateClip*>> m_CachedAnimates;
+
+	// Loaded clips by name. The first one loaded under a name wins, as it did when m_Animations was searched.
+	std::unordered_map<std::string, AnimationClip*> m_ClipsByName;
+
+	// Sorted by clip while m_PlaybacksSorted, so playbacks of the same clip read its keys one after another
+	std::vector<AnimationPlayback> m_Playbacks;
+	bool m_PlaybacksSorted;
+	bool m_Ticking;
+	uint32_t m_NextPlaybackId;
+
+	// Index of each playback in m_Playbacks by id, ids are the handles given out
+	std::unordered_map<uint32_t, size_t> m_PlaybackIndices;
+
+	typedef std::pair<cocos2d::Node*, AnimationClip*> PlaybackKey;
+	struct PlaybackKeyHash
+	{
+		size_t operator()(const PlaybackKey& key) const
+		{
+			return std::hash<void*>()(key.first) ^ (std::hash<void*>()(key.second) << 1);
+		}
+	};
+
+	// Ids of the running playbacks of each clip on each target
+	std::unordered_multimap<PlaybackKey, uint32_t, PlaybackKeyHash> m_PlaybacksByTarget;
+
+	AnimationPlayback::EventCallback m_EventCallback;
+
+	// Scale of every clip's time, of each group's by id (0 being no group), and the time step they advance by
+	float m_TimeScale;
+	std::unordered_map<std::string, uint32_t> m_GroupIds;
+	std::vector<float> m_GroupTimeScales;
+	float m_FixedTimeStep;
+	// Scaled time not stepped yet
+	float m_StepTime;
+
+	Culling m_Culling;
+	float m_CulledInterval;
+	bool m_QuantizedEvaluation;
+
+	// What the tick does with each playback, decided before they are evaluated
+	enum class TickState : uint8_t
+	{
+		Skip,
+		Update,
+		Culled,
+		// Evaluated on a worker, and did not loop
+		Ended
+	};
+	std::vector<TickState> m_TickStates;
+
+	// Blended playbacks of the frame, applied once they have all been added
+	AnimationBlender m_Blender;
+	// Root targets of the playbacks blended this tick, sorted
+	std::vector<cocos2d::Node*> m_BlendedTargets;
+
+	unsigned int m_EvaluationThreads;
+	// Started the first time there are enough clips to split
+	WorkerPool* m_Workers;
+
+	// Events fired during the tick. The playbacks keep their clips, and so the events, alive until the tick is over.
+	struct PendingEvent
+	{
+		AnimationPlayback::EventCallback callback;
+		cocos2d::Node* target;
+		const AnimEvent* event;
+	};
+	std::vector<PendingEvent> m_PendingEvents;
 
 	CREATOR_DISALLOW_COPY_ASSIGN_AND_MOVE(AnimationManager);
 };
@@ -0,0 +1,943 @@
+/****************************************************************************
+ Copyright (c) 2017 Chukong Technologies Inc.
+
+ http://www.cocos2d-x.org
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ****************************************************************************/
+
+#include "AnimationPlayback.h"
+#include "AnimateClip.h"
+#include "AnimationClip.h"
+#include "AnimationBlender.h"
+#include "AnimationClipProperties.h"
+
+#include "../CreatorReader.h"
+#include "../core/SpriteFrameCache.h"
+
+#include "ui/CocosGUI.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+USING_NS_CCR;
+
+namespace
+{
+typedef AnimationPlayback::Target Target;
+
+// The appliers of AnimationPlayback::getApplier, one per kind of track and of target
+void applyPosition(const Target& target, const float* value, const AnimationClip*)
+{
+	target.node->setPosition(cocos2d::Vec2(value[0], value[1]));
+	target.node->alignCenter();
+}
+
+void applyColor(const Target& target, const float* value, const AnimationClip*)
+{
+	target.node->setColor(cocos2d::Color3B(static_cast<GLubyte>(value[0]), static_cast<GLubyte>(value[1]), static_cast<GLubyte>(value[2])));
+}
+
+void applyScaleX(const Target& target, const float* value, const AnimationClip*)
+{
+	target.node->setScaleX(value[0]);
+}
+
+void applyScaleY(const Target& target, const float* value, const AnimationClip*)
+{
+	target.node->setScaleY(value[0]);
+}
+
+void applyRotation(const Target& target, const float* value, const AnimationClip*)
+{
+	target.node->setRotation(-value[0]);
+}
+
+void applySkewX(const Target& target, const float* value, const AnimationClip*)
+{
+	target.node->setSkewX(value[0]);
+}
+
+void applySkewY(const Target& target, const float* value, const AnimationClip*)
+{
+	target.node->setSkewY(value[0]);
+}
+
+void applyOpacity(const Target& target, const float* value, const AnimationClip*)
+{
+	target.node->setOpacity(static_cast<GLubyte>(value[0]));
+}
+
+// Shadows and outlines can be turned on at any time, so they are still checked here
+void applyLabelOpacity(const Target& target, const float* value, const AnimationClip*)
+{
+	auto label = target.label;
+	if (label->isShadowEnabled() || label->getLabelEffectType() != cocos2d::LabelEffect::NORMAL)
+	{
+		cocos2d::Color4B color = label->getTextColor();
+		label->setTextColor({color.r, color.g, color.b, static_cast<GLubyte>(value[0])});
+	}
+
+	label->setOpacity(static_cast<GLubyte>(value[0]));
+}
+
+void applyAnchorX(const Target& target, const float* value, const AnimationClip*)
+{
+	target.node->setAnchorPoint(cocos2d::Vec2(value[0], target.node->getAnchorPoint().y));
+}
+
+void applyAnchorY(const Target& target, const float* value, const AnimationClip*)
+{
+	target.node->setAnchorPoint(cocos2d::Vec2(target.node->getAnchorPoint().x, value[0]));
+}
+
+void applyActive(const Target& target, const float* value, const AnimationClip*)
+{
+	target.node->setVisible(value[0] != 0);
+}
+
+void applyWidth(const Target& target, const float* value, const AnimationClip*)
+{
+	auto size = target.node->getContentSize();
+	size.width = value[0];
+	target.node->setContentSize(size);
+}
+
+void applyHeight(const Target& target, const float* value, const AnimationClip*)
+{
+	auto size = target.node->getContentSize();
+	size.height = value[0];
+	target.node->setContentSize(size);
+}
+
+void applyButtonFrame(const Target& target, const float* value, const AnimationClip* clip)
+{
+	const auto& path = clip->getString(static_cast<size_t>(value[0]));
+	auto pSpriteFrame = cocos2d::SpriteFrameCache::getInstance()->getSpriteFrameByName(path);
+	if (pSpriteFrame)
+	{
+		target.button->getRendererNormal()->setSpriteFrame(pSpriteFrame);
+	}
+	else
+	{
+		target.button->getRendererNormal()->setTexture(path);
+	}
+}
+
+void applySpriteFrame(const Target& target, const float* value, const AnimationClip* clip)
+{
+	const auto& path = clip->getString(static_cast<size_t>(value[0]));
+	cocos2d::Sprite* pSprite = target.sprite;
+
+	auto pSpriteFrame = cocos2d::SpriteFrameCache::getInstance()->getSpriteFrameByName(path);
+	if (pSpriteFrame)
+	{
+		pSprite->setSpriteFrame(pSpriteFrame);
+	}
+	else
+	{
+		pSprite->setTexture(path);
+	}
+
+	if (creator::SpriteFrameCache::i()->IsNoSplit(path))
+	{
+		pSprite->setContentSize(pSprite->getContentSize() * creator::Reader::i()->GetSpriteRectScale());
+	}
+	else
+	{
+		pSprite->setContentSize(pSprite->getContentSize());
+	}
+}
+} // namespace
+
+AnimationPlayback::AnimationPlayback(uint32_t id, cocos2d::Node* rootTarget, AnimationClip* clip, const EndCallback& endCallback) :
+	_id(id),
+	_clip(clip),
+	_rootTarget(rootTarget),
+	_wrapper(nullptr),
+	_endCallback(endCallback),
+	_eventCallback(nullptr),
+	_targets(clip->getTrackSets().size()),
+	_pendingPaths(clip->getTrackSets().size()),
+	_appliers(clip->getTracks().size(), nullptr),
+	_values(clip->getTracks().size() * 3, 0.f),
+	_spans(clip->getTracks().size() * 2, std::numeric_limits<float>::quiet_NaN()),
+	_evaluated(false),
+	_appliedValues(clip->getTracks().size() * 3, std::numeric_limits<float>::quiet_NaN()),
+	_cursors(clip->getTracks().size(), 0),
+	_eventCursor(0),
+	_eventRound(-1),
+	_elapsed(0),
+	_durationToStop(clip->getDuration()),
+	_culledTime(0),
+	_quantized(false),
+	_speed(clip->getSpeed()),
+	_wrapMode(clip->getWrapMode()),
+	_weight(1),
+	_fadeWeight(1),
+	_fadeSpeed(0),
+	_stopWhenFaded(false),
+	_group(0),
+	_currentFramePlayed(false),
+	_paused(false),
+	_stopped(false)
+{
+	_clip->retain();
+	CC_SAFE_RETAIN(_rootTarget);
+
+	// Paths are only walked here, playback then works off the nodes
+	for (size_t i = 0; i < _targets.size(); ++i)
+	{
+		this->resolveTarget(i);
+	}
+}
+
+AnimationPlayback::AnimationPlayback(AnimationPlayback&& other) noexcept :
+	_id(other._id),
+	_clip(other._clip),
+	_rootTarget(other._rootTarget),
+	_wrapper(other._wrapper),
+	_endCallback(std::move(other._endCallback)),
+	_eventCallback(std::move(other._eventCallback)),
+	_targets(std::move(other._targets)),
+	_pendingPaths(std::move(other._pendingPaths)),
+	_appliers(std::move(other._appliers)),
+	_values(std::move(other._values)),
+	_spans(std::move(other._spans)),
+	_evaluated(other._evaluated),
+	_appliedValues(std::move(other._appliedValues)),
+	_cursors(std::move(other._cursors)),
+	_eventCursor(other._eventCursor),
+	_eventRound(other._eventRound),
+	_firedEvents(std::move(other._firedEvents)),
+	_elapsed(other._elapsed),
+	_durationToStop(other._durationToStop),
+	_culledTime(other._culledTime),
+	_quantized(other._quantized),
+	_speed(other._speed),
+	_wrapMode(other._wrapMode),
+	_weight(other._weight),
+	_fadeWeight(other._fadeWeight),
+	_fadeSpeed(other._fadeSpeed),
+	_stopWhenFaded(other._stopWhenFaded),
+	_group(other._group),
+	_currentFramePlayed(other._currentFramePlayed),
+	_paused(other._paused),
+	_stopped(other._stopped)
+{
+	other._clip = nullptr;
+	other._rootTarget = nullptr;
+	other._wrapper = nullptr;
+}
+
+AnimationPlayback& AnimationPlayback::operator=(AnimationPlayback&& other) noexcept
+{
+	if (this != &other)
+	{
+		this->releaseReferences();
+
+		_id = other._id;
+		_clip = other._clip;
+		_rootTarget = other._rootTarget;
+		_wrapper = other._wrapper;
+		_endCallback = std::move(other._endCallback);
+		_eventCallback = std::move(other._eventCallback);
+		_targets = std::move(other._targets);
+		_pendingPaths = std::move(other._pendingPaths);
+		_appliers = std::move(other._appliers);
+		_values = std::move(other._values);
+		_spans = std::move(other._spans);
+		_appliedValues = std::move(other._appliedValues);
+		_cursors = std::move(other._cursors);
+		_eventCursor = other._eventCursor;
+		_eventRound = other._eventRound;
+		_firedEvents = std::move(other._firedEvents);
+		_elapsed = other._elapsed;
+		_durationToStop = other._durationToStop;
+		_culledTime = other._culledTime;
+		_quantized = other._quantized;
+		_evaluated = other._evaluated;
+		_speed = other._speed;
+		_wrapMode = other._wrapMode;
+		_weight = other._weight;
+		_fadeWeight = other._fadeWeight;
+		_fadeSpeed = other._fadeSpeed;
+		_stopWhenFaded = other._stopWhenFaded;
+		_group = other._group;
+		_currentFramePlayed = other._currentFramePlayed;
+		_paused = other._paused;
+		_stopped = other._stopped;
+
+		other._clip = nullptr;
+		other._rootTarget = nullptr;
+		other._wrapper = nullptr;
+	}
+
+	return *this;
+}
+
+AnimationPlayback::~AnimationPlayback()
+{
+	this->releaseReferences();
+}
+
+void AnimationPlayback::releaseReferences()
+{
+	for (auto& target : _targets)
+	{
+		CC_SAFE_RELEASE(target.node);
+	}
+
+	_targets.clear();
+
+	for (auto& pending : _pendingPaths)
+	{
+		CC_SAFE_RELEASE(pending.parent);
+	}
+
+	_pendingPaths.clear();
+	CC_SAFE_RELEASE_NULL(_wrapper);
+	CC_SAFE_RELEASE_NULL(_clip);
+	CC_SAFE_RELEASE_NULL(_rootTarget);
+}
+
+void AnimationPlayback::setWrapper(AnimateClip* wrapper)
+{
+	CC_SAFE_RETAIN(wrapper);
+	CC_SAFE_RELEASE(_wrapper);
+	_wrapper = wrapper;
+}
+
+void AnimationPlayback::setQuantized(bool quantized)
+{
+	_quantized = quantized;
+
+	// Values held for a sample are evaluated again in the new mode
+	std::fill(_spans.begin(), _spans.end(), std::numeric_limits<float>::quiet_NaN());
+}
+
+void AnimationPlayback::setWeight(float weight)
+{
+	_weight = weight;
+	_fadeWeight = weight;
+	_fadeSpeed = 0;
+}
+
+void AnimationPlayback::fadeTo(float weight, float duration, bool stopWhenFaded)
+{
+	_fadeWeight = weight;
+	_stopWhenFaded = stopWhenFaded;
+
+	if (duration > 0 && weight != _weight)
+	{
+		_fadeSpeed = (weight - _weight) / duration;
+	}
+	else
+	{
+		// Takes effect on the next update, which also ends the playback if that is what was asked
+		_weight = weight;
+		_fadeSpeed = 0;
+	}
+}
+
+void AnimationPlayback::seek(float time)
+{
+	_elapsed = std::max(time, 0.f);
+	if (!this->isLooping())
+		_elapsed = std::min(_elapsed, _durationToStop);
+
+	_currentFramePlayed = false;
+	_culledTime = 0;
+
+	// Values held over a span may not be the ones at the new time, and getValidIndex falls back to a binary search
+	// when the cursors are too far off
+	std::fill(_spans.begin(), _spans.end(), std::numeric_limits<float>::quiet_NaN());
+	this->seekEvents();
+}
+
+bool AnimationPlayback::update(float dt)
+{
+	const bool running = this->evaluate(dt);
+	this->apply();
+	return running;
+}
+
+bool AnimationPlayback::updateCulled(float dt, float interval)
+{
+	const bool running = this->evaluateCulled(dt, interval);
+	this->apply();
+	return running;
+}
+
+bool AnimationPlayback::evaluate(float dt)
+{
+	_culledTime = 0;
+	return this->advance(dt, true);
+}
+
+bool AnimationPlayback::evaluateCulled(float dt, float interval)
+{
+	_culledTime += dt;
+
+	const bool evaluate = interval >= 0 && _culledTime >= interval;
+	if (evaluate)
+		_culledTime = 0;
+
+	return this->advance(dt, evaluate);
+}
+
+bool AnimationPlayback::advance(float dt, bool evaluate)
+{
+	if (_fadeSpeed != 0)
+	{
+		_weight += _fadeSpeed * dt;
+		if (_fadeSpeed > 0 ? _weight >= _fadeWeight : _weight <= _fadeWeight)
+		{
+			_weight = _fadeWeight;
+			_fadeSpeed = 0;
+		}
+	}
+
+	// This ensures that the clip starts at 0
+	if (_currentFramePlayed)
+	{
+		_elapsed += (dt * _speed);
+	}
+	else
+	{
+		_currentFramePlayed = true;
+	}
+
+	// For making sure that the last frame is played properly
+	const bool ended = !this->isLooping() && _elapsed >= _durationToStop;
+	if (ended)
+		_elapsed = _durationToStop;
+
+	// Faded out for good, ends like a clip that ran to its end
+	const bool faded = _stopWhenFaded && _fadeSpeed == 0 && _weight <= 0;
+
+	this->collectEvents();
+
+	// A clip ending while culled still gets its last frame: the playback is gone by the time its node is shown again
+	_evaluated = evaluate || ended;
+	if (!_evaluated)
+		return !ended && !faded;
+
+	// Only the clip and this playback are touched here, nodes are left to apply
+	const auto elapsed = computeElapse();
+	const auto& tracks = _clip->getTracks();
+	const float duration = _clip->getDuration();
+	const float sample = _clip->getSample();
+	for (size_t i = 0; i < tracks.size(); ++i)
+	{
+		// Still holding the value evaluated last, see _spans
+		float& from = _spans[i * 2];
+		float& until = _spans[i * 2 + 1];
+		if (elapsed >= from && elapsed < until)
+			continue;
+
+		const AnimTrack& track = tracks[i];
+		if (AnimationClip::isStepped(track.type))
+		{
+			_clip->evaluate(track, elapsed, _cursors[i], &_values[i * 3]);
+			_clip->getStepSpan(track, elapsed, _cursors[i], from, until);
+		}
+		else if (_quantized && sample > 0 && elapsed < duration)
+		{
+			// Evaluated at the start of the clip sample elapsed is in; the end of the clip is left exact
+			const float index = std::floor(elapsed * sample);
+			from = index / sample;
+			until = std::min((index + 1) / sample, duration);
+			_clip->evaluate(track, from, _cursors[i], &_values[i * 3]);
+		}
+		else
+		{
+			_clip->evaluate(track, elapsed, _cursors[i], &_values[i * 3]);
+		}
+	}
+
+	return !ended && !faded;
+}
+
+void AnimationPlayback::apply()
+{
+	if (!_evaluated)
+		return;
+
+	_evaluated = false;
+
+	const auto& trackSets = _clip->getTrackSets();
+	for (size_t i = 0; i < trackSets.size(); ++i)
+	{
+		auto target = this->getAppliedTarget(i);
+		if (target)
+			this->apply(trackSets[i], *target);
+	}
+}
+
+void AnimationPlayback::blend(AnimationBlender& blender)
+{
+	if (!_evaluated)
+		return;
+
+	_evaluated = false;
+
+	// What the nodes end up with is the blend's, apply writes everything again once the clip is no longer blended
+	std::fill(_appliedValues.begin(), _appliedValues.end(), std::numeric_limits<float>::quiet_NaN());
+
+	if (_weight <= 0)
+		return;
+
+	const auto& trackSets = _clip->getTrackSets();
+	const auto& tracks = _clip->getTracks();
+	for (size_t i = 0; i < trackSets.size(); ++i)
+	{
+		auto target = this->getAppliedTarget(i);
+		if (!target)
+			continue;
+
+		for (uint32_t j = trackSets[i].firstTrack, end = trackSets[i].firstTrack + trackSets[i].trackCount; j < end; ++j)
+		{
+			blender.add(*target, tracks[j].type, &_values[j * 3], _weight, _appliers[j], _clip);
+		}
+	}
+}
+
+const AnimationPlayback::Target* AnimationPlayback::getAppliedTarget(size_t trackSet)
+{
+	const Target* target = &_targets[trackSet];
+	if (target->node)
+	{
+		if (target->node != _rootTarget && !target->node->getParent())
+			target = &this->resolveTarget(trackSet);
+	}
+	else
+	{
+		// Not found so far, looked up again once the node the lookup stopped at changes, see _pendingPaths
+		const PendingPath& pending = _pendingPaths[trackSet];
+		if (pending.parent &&
+			(pending.parent->getChildrenCount() != pending.childCount || (pending.parent != _rootTarget && !pending.parent->getParent())))
+		{
+			target = &this->resolveTarget(trackSet);
+		}
+	}
+
+	return target->node ? target : nullptr;
+}
+
+const AnimationPlayback::Target& AnimationPlayback::resolveTarget(size_t trackSet)
+{
+	cocos2d::Node* parent = nullptr;
+	auto node = this->getTarget(_clip->getTrackSets()[trackSet].path, parent);
+	CC_SAFE_RETAIN(node);
+	CC_SAFE_RELEASE(_targets[trackSet].node);
+
+	// A path that is not found keeps an eye on where its lookup stopped
+	PendingPath& pending = _pendingPaths[trackSet];
+	cocos2d::Node* watched = node ? nullptr : parent;
+	CC_SAFE_RETAIN(watched);
+	CC_SAFE_RELEASE(pending.parent);
+	pending.parent = watched;
+	pending.childCount = watched ? watched->getChildrenCount() : 0;
+
+	Target& target = _targets[trackSet];
+	target.node = node;
+	target.label = dynamic_cast<cocos2d::Label*>(node);
+	target.sprite = dynamic_cast<cocos2d::Sprite*>(node);
+	target.button = dynamic_cast<cocos2d::ui::Button*>(node);
+
+	// The casts above are the only ones, each track's setter is picked here for what the node turned out to be
+	const auto& trackSetInfo = _clip->getTrackSets()[trackSet];
+	const auto& tracks = _clip->getTracks();
+	for (uint32_t i = trackSetInfo.firstTrack, end = trackSetInfo.firstTrack + trackSetInfo.trackCount; i < end; ++i)
+	{
+		_appliers[i] = node ? getApplier(tracks[i].type, target) : nullptr;
+	}
+
+	// A new node has none of the values applied yet
+	auto applied = _appliedValues.begin() + trackSetInfo.firstTrack * 3;
+	std::fill(applied, applied + trackSetInfo.trackCount * 3, std::numeric_limits<float>::quiet_NaN());
+
+	return target;
+}
+
+void AnimationPlayback::apply(const AnimTrackSet& trackSet, const Target& animTarget)
+{
+	cocos2d::Node* target = animTarget.node;
+	const auto& tracks = _clip->getTracks();
+
+	// Position X and Y are applied together, once both have been evaluated
+	float x = 0, y = 0;
+	bool animateX = false, animateY = false;
+
+	for (uint32_t i = trackSet.firstTrack, end = trackSet.firstTrack + trackSet.trackCount; i < end; ++i)
+	{
+		const AnimTrack& track = tracks[i];
+		if ((animateX || animateY) && track.type > AnimTrackType::PositionY)
+		{
+			setPositionXY(target, animateX, x, animateY, y);
+			animateX = animateY = false;
+		}
+
+		const float* value = &_values[i * 3];
+		float* applied = &_appliedValues[i * 3];
+		if (std::equal(value, value + track.components, applied))
+			continue;
+
+		std::copy(value, value + track.components, applied);
+
+		switch (track.type)
+		{
+		case AnimTrackType::PositionX:
+			x = value[0];
+			animateX = true;
+			break;
+		case AnimTrackType::PositionY:
+			y = value[0];
+			animateY = true;
+			break;
+		default:
+			if (_appliers[i])
+				_appliers[i](animTarget, value, _clip);
+			break;
+		}
+	}
+
+	if (animateX || animateY)
+		setPositionXY(target, animateX, x, animateY, y);
+}
+
+AnimationPlayback::Applier AnimationPlayback::getApplier(AnimTrackType type, const Target& target)
+{
+	switch (type)
+	{
+	case AnimTrackType::Position:
+		return applyPosition;
+	case AnimTrackType::Color:
+		return applyColor;
+	case AnimTrackType::ScaleX:
+		return applyScaleX;
+	case AnimTrackType::ScaleY:
+		return applyScaleY;
+	case AnimTrackType::Rotation:
+		return applyRotation;
+	case AnimTrackType::SkewX:
+		return applySkewX;
+	case AnimTrackType::SkewY:
+		return applySkewY;
+	case AnimTrackType::Opacity:
+		return target.label ? applyLabelOpacity : applyOpacity;
+	case AnimTrackType::AnchorX:
+		return applyAnchorX;
+	case AnimTrackType::AnchorY:
+		return applyAnchorY;
+	case AnimTrackType::Active:
+		return applyActive;
+	case AnimTrackType::Width:
+		return applyWidth;
+	case AnimTrackType::Height:
+		return applyHeight;
+	case AnimTrackType::SpriteFrame:
+		// Buttons show the frame on their normal renderer. Other nodes have no frame to set.
+		if (target.button)
+			return applyButtonFrame;
+		return target.sprite ? applySpriteFrame : nullptr;
+	default:
+		return nullptr;
+	}
+}
+
+void AnimationPlayback::readValue(const Target& animTarget, AnimTrackType type, float* value)
+{
+	cocos2d::Node* target = animTarget.node;
+
+	switch (type)
+	{
+	case AnimTrackType::Position: {
+		const auto position = target->getCreatorPosition();
+		value[0] = position.x;
+		value[1] = position.y;
+	}
+	break;
+	case AnimTrackType::Color: {
+		const auto& color = target->getColor();
+		value[0] = color.r;
+		value[1] = color.g;
+		value[2] = color.b;
+	}
+	break;
+	case AnimTrackType::ScaleX:
+		value[0] = target->getScaleX();
+		break;
+	case AnimTrackType::ScaleY:
+		value[0] = target->getScaleY();
+		break;
+	case AnimTrackType::Rotation:
+		value[0] = -target->getRotation();
+		break;
+	case AnimTrackType::SkewX:
+		value[0] = target->getSkewX();
+		break;
+	case AnimTrackType::SkewY:
+		value[0] = target->getSkewY();
+		break;
+	case AnimTrackType::Opacity:
+		value[0] = target->getOpacity();
+		break;
+	case AnimTrackType::AnchorX:
+		value[0] = target->getAnchorPoint().x;
+		break;
+	case AnimTrackType::AnchorY:
+		value[0] = target->getAnchorPoint().y;
+		break;
+	case AnimTrackType::PositionX:
+		value[0] = target->getCreatorPosition().x;
+		break;
+	case AnimTrackType::PositionY:
+		value[0] = target->getCreatorPosition().y;
+		break;
+	case AnimTrackType::Active:
+		value[0] = target->isVisible() ? 1.f : 0.f;
+		break;
+	case AnimTrackType::Width:
+		value[0] = target->getContentSize().width;
+		break;
+	case AnimTrackType::Height:
+		value[0] = target->getContentSize().height;
+		break;
+	default:
+		break;
+	}
+}
+
+void AnimationPlayback::setPositionXY(cocos2d::Node* target, bool animateX, float x, bool animateY, float y)
+{
+	if (animateX && animateY)
+	{
+		target->setPosition(cocos2d::Vec2(x, y));
+		target->alignCenter();
+	}
+	else if (animateX)
+	{
+		target->setPositionX(x);
+		y = target->getPositionY();
+		target->alignCenter();
+		target->setPositionY(y);
+	}
+	else if (animateY)
+	{
+		target->setPositionY(y);
+		x = target->getPositionX();
+		target->alignCenter();
+		target->setPositionX(x);
+	}
+}
+
+cocos2d::Node* AnimationPlayback::getTarget(const std::string& path, cocos2d::Node*& parent) const
+{
+	parent = nullptr;
+	if (path.empty())
+		return _rootTarget;
+
+	// Split the path
+	std::vector<std::string> tokens;
+	std::istringstream iss(path);
+	std::string token;
+	auto result = std::back_inserter(tokens);
+	while (std::getline(iss, token, '/'))
+	{
+		*result++ = token;
+	}
+
+	cocos2d::Node* node = _rootTarget;
+	for (std::size_t i = 0; i < tokens.size(); ++i)
+	{
+		auto name = tokens[i];
+		parent = node;
+		node = node->getChildByName(name);
+
+		// If this node is of type scrollview
+		if (i < (tokens.size() - 1))
+		{
+			auto scrollview = dynamic_cast<cocos2d::ui::ScrollView*>(node);
+			if (scrollview)
+			{
+				node = scrollview->getInnerContainer();
+			}
+		}
+
+		if (!node)
+		{
+			CCLOG("Failed to find node: %s", name.c_str());
+			break;
+		}
+	}
+
+	return node;
+
+	// cocos2d::Node* ret = nullptr;
+	// _rootTarget->enumerateChildren(path, [&ret](cocos2d::Node* result) -> bool {
+	// 	ret = result;
+	// 	return true;
+	// });
+	// return ret;
+}
+
+bool AnimationPlayback::isLooping() const
+{
+	return _wrapMode == AnimationClip::WrapMode::Loop ||
+		   _wrapMode == AnimationClip::WrapMode::LoopReverse ||
+		   _wrapMode == AnimationClip::WrapMode::PingPong ||
+		   _wrapMode == AnimationClip::WrapMode::PingPongReverse;
+}
+
+bool AnimationPlayback::isReverseRound(int round) const
+{
+	const bool oddRound = (round % 2) == 0;
+	return _wrapMode == AnimationClip::WrapMode::Reverse						   // reverse mode
+		   || (_wrapMode == AnimationClip::WrapMode::PingPong && !oddRound)		   // pingpong mode and it is the second round
+		   || (_wrapMode == AnimationClip::WrapMode::PingPongReverse && oddRound) // pingpongreverse mode and it is the first round
+		   || (_wrapMode == AnimationClip::WrapMode::LoopReverse);				   // loop reverse mode, reverse again and again
+}
+
+void AnimationPlayback::collectEvents()
+{
+	const auto& events = _clip->getEvents();
+	const float duration = _clip->getDuration();
+	if (events.empty() || duration <= 0)
+		return;
+
+	// Clips that do not loop have a single round, their end included
+	const int round = this->isLooping() ? static_cast<int>(_elapsed / duration) : 0;
+	if (round < _eventRound)
+	{
+		this->seekEvents();
+		return;
+	}
+
+	// Rounds left behind fire the rest of their events first
+	while (_eventRound < round)
+	{
+		bool wasReverse = false;
+		if (_eventRound >= 0)
+		{
+			wasReverse = this->isReverseRound(_eventRound);
+			this->fireEvents(wasReverse ? 0 : duration, wasReverse);
+		}
+
+		// Rounds passed over whole are skipped rather than fired one after the other, so a long catch-up fires the end
+		// of the round it leaves and the start of the one it lands in, whatever the number of loops in between
+		if (_eventRound + 1 < round)
+		{
+			_eventRound = round - 1;
+			wasReverse = this->isReverseRound(_eventRound);
+		}
+
+		++_eventRound;
+		const bool reverse = this->isReverseRound(_eventRound);
+		_eventCursor = reverse ? static_cast<uint32_t>(events.size()) : 0;
+
+		// Ping-pong turns around where the last round ended, its events there have just fired
+		if (_eventRound > 0 && reverse != wasReverse)
+			this->skipEvents(reverse ? duration : 0, reverse);
+	}
+
+	const bool reverse = this->isReverseRound(round);
+	const float time = std::min(_elapsed - round * duration, duration);
+	this->fireEvents(reverse ? duration - time : time, reverse);
+}
+
+void AnimationPlayback::fireEvents(float time, bool reverse)
+{
+	const auto& events = _clip->getEvents();
+	if (reverse)
+	{
+		while (_eventCursor > 0 && events[_eventCursor - 1].time >= time)
+		{
+			_firedEvents.push_back(--_eventCursor);
+		}
+	}
+	else
+	{
+		while (_eventCursor < events.size() && events[_eventCursor].time <= time)
+		{
+			_firedEvents.push_back(_eventCursor++);
+		}
+	}
+}
+
+void AnimationPlayback::skipEvents(float time, bool reverse)
+{
+	const auto& events = _clip->getEvents();
+	if (reverse)
+	{
+		while (_eventCursor > 0 && events[_eventCursor - 1].time >= time)
+			--_eventCursor;
+	}
+	else
+	{
+		while (_eventCursor < events.size() && events[_eventCursor].time <= time)
+			++_eventCursor;
+	}
+}
+
+void AnimationPlayback::seekEvents()
+{
+	const auto& events = _clip->getEvents();
+	const float duration = _clip->getDuration();
+	if (events.empty() || duration <= 0)
+		return;
+
+	_eventRound = this->isLooping() ? static_cast<int>(_elapsed / duration) : 0;
+
+	// Events at the current time count as fired
+	const float time = std::min(_elapsed - _eventRound * duration, duration);
+	if (this->isReverseRound(_eventRound))
+	{
+		auto it = std::lower_bound(events.begin(), events.end(), duration - time, [](const AnimEvent& event, float time) {
+			return event.time < time;
+		});
+		_eventCursor = static_cast<uint32_t>(it - events.begin());
+	}
+	else
+	{
+		auto it = std::upper_bound(events.begin(), events.end(), time, [](float time, const AnimEvent& event) {
+			return time < event.time;
+		});
+		_eventCursor = static_cast<uint32_t>(it - events.begin());
+	}
+}
+
+float AnimationPlayback::computeElapse() const
+{
+	auto elapsed = _elapsed;
+	auto duration = _clip->getDuration();
+
+	// as the time goes, _elapsed will be bigger than duration when the clip loops
+	if (elapsed != duration) // Allows to run the last frame perfectly
+	{
+		elapsed = fmodf(elapsed, duration);
+	}
+
+	if (this->isReverseRound(static_cast<int>(_elapsed / duration)))
+		elapsed = duration - elapsed;
+
+	return elapsed;
+}
@@ -0,0 +1,259 @@
+/****************************************************************************
+ Copyright (c) 2017 Chukong Technologies Inc.
+
+ http://www.cocos2d-x.org
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ****************************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "cocos2d.h"
+#include "ui/CocosGUI.h"
+
+#include "../Macros.h"
+#include "AnimationClip.h"
+
+NS_CCR_BEGIN
+
+class AnimateClip;
+class AnimationBlender;
+
+// State of one running clip. AnimationManager keeps these in a flat array and advances all of them from a single tick.
+// It holds a reference on the clip, the root target and the AnimateClip wrapper (if any) for as long as it lives.
+// The clip is shared by every playback of it and only read; anything that may differ between two plays lives here.
+class AnimationPlayback
+{
+public:
+	typedef std::function<void()> EndCallback;
+	typedef std::function<void(cocos2d::Node* target, const AnimEvent& event)> EventCallback;
+
+	// Node animated by a track set, and what it is for the setters that depend on it
+	struct Target
+	{
+		cocos2d::Node* node = nullptr;
+		cocos2d::Label* label = nullptr;
+		cocos2d::Sprite* sprite = nullptr;
+		cocos2d::ui::Button* button = nullptr;
+	};
+
+	AnimationPlayback(uint32_t id, cocos2d::Node* rootTarget, AnimationClip* clip, const EndCallback& endCallback);
+	AnimationPlayback(AnimationPlayback&& other) noexcept;
+	AnimationPlayback& operator=(AnimationPlayback&& other) noexcept;
+	~AnimationPlayback();
+
+	/**
+	 Advances the clip by `dt` seconds and applies it to its targets. The clip's events crossed on the way are added
+	 to getFiredEvents, in the order they were crossed, for the manager to dispatch.
+	 @return false once a clip that does not loop has applied its last frame
+	 */
+	bool update(float dt);
+
+	/**
+	 Same as update, for a playback whose target is not shown: time still moves on, events fire and the clip ends on
+	 time, but it is only evaluated and applied once every `interval` seconds (not at all if negative), and when it
+	 ends. The next update applies it at the right time again.
+	 */
+	bool updateCulled(float dt, float interval);
+
+	// update and updateCulled in two steps. evaluate only touches the playback and reads its clip, so playbacks can
+	// be evaluated on any thread, in parallel; apply then writes the values to the nodes on the cocos thread.
+	bool evaluate(float dt);
+	bool evaluateCulled(float dt, float interval);
+	void apply();
+
+	/**
+	 Instead of apply, adds the values evaluated to the blender with the playback's weight. For playbacks that
+	 isBlended, AnimationBlender::apply then writes them along with those of the other clips on the same nodes.
+	 */
+	void blend(AnimationBlender& blender);
+
+	/**
+	 Weight of the clip in the blend of its nodes' properties, 1 when not blended. fadeTo moves it to `weight` over
+	 `duration` seconds of update time (whatever the clip's speed); once there, the playback ends if it faded to 0 and
+	 `stopWhenFaded` is set.
+	 */
+	inline float getWeight() const { return _weight; }
+	void setWeight(float weight);
+	void fadeTo(float weight, float duration, bool stopWhenFaded);
+	inline bool isBlended() const { return _weight != 1 || _fadeSpeed != 0; }
+
+	// Indices into the clip's events, kept until cleared by the caller of update
+	inline const std::vector<uint32_t>& getFiredEvents() const { return _firedEvents; }
+	inline void clearFiredEvents() { _firedEvents.clear(); }
+
+	inline uint32_t getId() const { return _id; }
+	inline AnimationClip* getClip() const { return _clip; }
+	inline cocos2d::Node* getRootTarget() const { return _rootTarget; }
+
+	// Start out as the clip's
+	inline float getSpeed() const { return _speed; }
+	inline void setSpeed(float speed) { _speed = speed; }
+	inline AnimationClip::WrapMode getWrapMode() const { return _wrapMode; }
+	inline void setWrapMode(AnimationClip::WrapMode wrapMode) { _wrapMode = wrapMode; }
+
+	/**
+	 Moves the playback to `time` seconds of clip time (before speed, and past the duration for looping clips), where
+	 the next update evaluates it without moving on first. The events in between do not fire; those at `time`
+	 count as fired. Every track finds its key again by binary search, the cost does not depend on how far it moved.
+	 */
+	void seek(float time);
+
+	// Time scale group in the manager, 0 for none
+	inline uint32_t getGroup() const { return _group; }
+	inline void setGroup(uint32_t group) { _group = group; }
+
+	/**
+	 Quantized playbacks evaluate their tracks at the clip's sample rate (AnimationClip::getSample) rather than every
+	 frame: a value is computed at the start of the sample the playback is in and kept until it moves to another
+	 one. Motion then steps at the sample rate, on a display refreshing faster the frames in between cost nothing.
+	 Stepped tracks (Active, SpriteFrame) are only evaluated again on their next key either way.
+	 */
+	inline bool isQuantized() const { return _quantized; }
+	void setQuantized(bool quantized);
+
+	inline bool isPaused() const { return _paused; }
+	inline void setPaused(bool paused) { _paused = paused; }
+
+	// Stopped playbacks are removed by the manager at the end of the tick
+	inline bool isStopped() const { return _stopped; }
+	inline void stop() { _stopped = true; }
+
+	inline const EndCallback& getEndCallback() const { return _endCallback; }
+	inline void setEndCallback(const EndCallback& endCallback) { _endCallback = endCallback; }
+
+	// Falls back to the manager's when not set
+	inline const EventCallback& getEventCallback() const { return _eventCallback; }
+	inline void setEventCallback(const EventCallback& eventCallback) { _eventCallback = eventCallback; }
+
+	inline AnimateClip* getWrapper() const { return _wrapper; }
+	void setWrapper(AnimateClip* wrapper);
+
+	/**
+	 Writes a value of one kind of track to a target. Each track is bound to one when its target is resolved, picked
+	 for what the node is (a label's opacity, a button's frame...), so applying a value is a single call without casts
+	 or checks of the node's type. SpriteFrame values index the strings of `clip`.
+	 */
+	typedef void (*Applier)(const Target& target, const float* value, const AnimationClip* clip);
+
+	// Null for PositionX and PositionY, applied through setPositionXY so a node animating both only moves once, and
+	// for the tracks the target has nothing to apply to
+	static Applier getApplier(AnimTrackType type, const Target& target);
+	static void setPositionXY(cocos2d::Node* target, bool animateX, float x, bool animateY, float y);
+
+	// What a kind of track is on the node now, in the floats of its values: positions in Creator space, as the
+	// tracks have them, rather than the node's after alignCenter. What blends are mixed with.
+	static void readValue(const Target& target, AnimTrackType type, float* value);
+
+private:
+	void apply(const AnimTrackSet& trackSet, const Target& target);
+	// Target of the track set, looked up again if removed since, or if it was not found and may be there now. Null if
+	// there is no node to apply it to.
+	const Target* getAppliedTarget(size_t trackSet);
+	// `parent` is set to the last node walked: the target's parent, or the node missing the next name on the path
+	cocos2d::Node* getTarget(const std::string& path, cocos2d::Node*& parent) const;
+	const Target& resolveTarget(size_t trackSet);
+	bool advance(float dt, bool evaluate);
+	float computeElapse() const;
+	bool isLooping() const;
+	bool isReverseRound(int round) const;
+	void releaseReferences();
+
+	// Adds the events crossed since the last call to _firedEvents, see _eventCursor
+	void collectEvents();
+	void fireEvents(float time, bool reverse);
+	void skipEvents(float time, bool reverse);
+	// Moves the event cursor to the current time without firing anything, for when time went backwards
+	void seekEvents();
+
+	uint32_t _id;
+	AnimationClip* _clip;
+	cocos2d::Node* _rootTarget;
+	AnimateClip* _wrapper;
+	EndCallback _endCallback;
+	EventCallback _eventCallback;
+
+	// Node of each of the clip's track sets, resolved once when the playback starts. Cocos has no weak references, so
+	// they are retained; a node that has been removed from its parent since is looked up again.
+	std::vector<Target> _targets;
+
+	// For each track set whose path was not found, the last node its lookup walked (retained) and that node's child
+	// count then. The path is looked up again once the count changes or the node is removed, as when the missing
+	// child is added later on.
+	struct PendingPath
+	{
+		cocos2d::Node* parent = nullptr;
+		ssize_t childCount = 0;
+	};
+	std::vector<PendingPath> _pendingPaths;
+	// Setter of each of the clip's tracks for its target, see Applier
+	std::vector<Applier> _appliers;
+
+	// Value of each track evaluated last (3 floats per track), and whether apply still has to write them
+	std::vector<float> _values;
+	// Per track, the span [from, until) of clip time over which its value above stays as it is: between two keys for
+	// stepped tracks, within one clip sample when quantized. Empty (NaN) for the others, evaluated every time.
+	std::vector<float> _spans;
+	bool _evaluated;
+
+	// Value each track applied last (3 floats per track, NaN before the first time). Setters are only called when it
+	// changes, so flat segments and finished tracks cost an evaluation and nothing else.
+	std::vector<float> _appliedValues;
+
+	// Keyframe cursor of each of the clip's tracks, see getValidIndex
+	std::vector<int> _cursors;
+
+	// Playing forwards, the index of the next event of the round (pass over the clip) to fire. Playing backwards (reverse
+	// and ping-pong rounds), one past it. Only moves over the events crossed, and resets when a round ends.
+	uint32_t _eventCursor;
+	// Round _eventCursor is in, -1 before the first update
+	int _eventRound;
+	std::vector<uint32_t> _firedEvents;
+
+	// the time elapsed since the animation start
+	float _elapsed;
+	float _durationToStop;
+	// Time since the clip was last applied while culled, see updateCulled
+	float _culledTime;
+	bool _quantized;
+	float _speed;
+	AnimationClip::WrapMode _wrapMode;
+
+	// Weight in the blend, and the fade moving it towards _fadeWeight by _fadeSpeed a second, see fadeTo
+	float _weight;
+	float _fadeWeight;
+	float _fadeSpeed;
+	bool _stopWhenFaded;
+
+	uint32_t _group;
+
+	bool _currentFramePlayed;
+	bool _paused;
+	bool _stopped;
+
+	// Movable so the manager can keep them in a vector, but never copied: copies would share the references
+	AnimationPlayback(const AnimationPlayback&) = delete;
+	AnimationPlayback& operator=(const AnimationPlayback&) = delete;
+};
+
+NS_CCR_END
@@ -45,6 +45,26 @@ float crt(float v)
 		return std::pow(v, 1.f / 3.f);
 }
 
+// t in [lo, hi] where ((ax * t + bx) * t + cx) * t = x, refined from `t` by Newton's steps. A step leaving the bracket
+// bisects it instead.
+template <typename T>
+T solve(T ax, T bx, T cx, T x, T lo, T hi, T t, int iterations)
+{
+	for (int k = 0; k < iterations; ++k)
+	{
+		const T error = ((ax * t + bx) * t + cx) * t - x;
+		const T slope = (3 * ax * t + 2 * bx) * t + cx;
+
+		lo = error < 0 ? t : lo;
+		hi = error < 0 ? hi : t;
+
+		const T newton = t - error / slope;
+		t = (newton >= lo && newton <= hi) ? newton : (lo + hi) / 2;
+	}
+
+	return t;
+}
+
 float max(float v1, float v2, float v3)
 {
 	return std::max(v1,
@@ -174,6 +194,109 @@ float computeBezier(const std::vector<float>& controlPoints, float x)
 		   p2y * 3 * percent * percent * t1 +
 		   p3y * percent * percent * percent;
 }
+
+// The identity, with control points (1/3, 1/3, 2/3, 2/3): x(t) = y(t) = t, so the tables need no solving
+Evaluator::Evaluator()
+	: m_FlatMiddle(false)
+{
+	for (auto& half : m_Halves)
+	{
+		half.ax = half.bx = half.ay = half.by = 0;
+		half.cx = half.cy = 1;
+		for (int i = 0; i < kSampleCount; ++i)
+		{
+			const float w = static_cast<float>(i) / (kSampleCount - 1);
+			half.samples[i] = 0.5f * w * w;
+		}
+	}
+}
+
+Evaluator::Evaluator(const std::vector<float>& controlPoints)
+{
+	const float x1 = controlPoints[0];
+	const float y1 = controlPoints[1];
+	const float x2 = controlPoints[2];
+	const float y2 = controlPoints[3];
+
+	build(m_Halves[0], x1, y1, x2, y2);
+	build(m_Halves[1], 1 - x2, 1 - y2, 1 - x1, 1 - y1);
+
+	// Smallest slope of x(t) between the ends, where x''(t) = 0. Flat ends are handled by the tables.
+	const Half& curve = m_Halves[0];
+	float flattest = 3;
+	if (curve.ax > 0)
+	{
+		const float t = -curve.bx / (3 * curve.ax);
+		if (t > 0 && t < 1)
+			flattest = (3 * curve.ax * t + 2 * curve.bx) * t + curve.cx;
+	}
+
+	m_FlatMiddle = flattest < 0.1f;
+}
+
+void Evaluator::build(Half& half, float x1, float y1, float x2, float y2)
+{
+	half.cx = 3 * x1;
+	half.bx = 3 * (x2 - x1) - half.cx;
+	half.ax = 1 - half.cx - half.bx;
+
+	half.cy = 3 * y1;
+	half.by = 3 * (y2 - y1) - half.cy;
+	half.ay = 1 - half.cy - half.by;
+
+	// x(t) is increasing for control points in [0, 1], so every x has a single t. Bisecting is slow but exact.
+	for (int i = 0; i < kSampleCount; ++i)
+	{
+		const double w = static_cast<double>(i) / (kSampleCount - 1);
+		const double x = 0.5 * w * w;
+		double lo = 0;
+		double hi = 1;
+		for (int k = 0; k < 50; ++k)
+		{
+			const double t = 0.5 * (lo + hi);
+			if (((half.ax * t + half.bx) * t + half.cx) * t < x)
+				lo = t;
+			else
+				hi = t;
+		}
+
+		half.samples[i] = static_cast<float>(0.5 * (lo + hi));
+	}
+}
+
+float Evaluator::evaluate(float ratio) const
+{
+	float result;
+	this->evaluate(&ratio, &result, 1);
+	return result;
+}
+
+void Evaluator::evaluate(const float* ratios, float* out, size_t count) const
+{
+	const float scale = static_cast<float>(kSampleCount - 1);
+
+	for (size_t n = 0; n < count; ++n)
+	{
+		const float ratio = std::min(std::max(ratios[n], 0.f), 1.f);
+		const bool upper = ratio > 0.5f;
+		const float x = upper ? 1 - ratio : ratio;
+		const Half& half = m_Halves[upper];
+
+		// Table entries bracketing x, and a first guess interpolated between them
+		const float position = std::sqrt(2 * x) * scale;
+		const int i = std::min(static_cast<int>(position), kSampleCount - 2);
+		const float lo = half.samples[i];
+		const float hi = half.samples[i + 1];
+		const float guess = lo + (position - i) * (hi - lo);
+
+		const float t = m_FlatMiddle
+			? static_cast<float>(solve<double>(half.ax, half.bx, half.cx, x, lo, hi, guess, kFlatIterations))
+			: solve(half.ax, half.bx, half.cx, x, lo, hi, guess, kIterations);
+
+		const float y = ((half.ay * t + half.by) * t + half.cy) * t;
+		out[n] = upper ? 1 - y : y;
+	}
+}
 } // namespace Bazier
 
 NS_CCR_END
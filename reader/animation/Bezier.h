@@ -25,13 +25,61 @@
 
 #include "../Macros.h"
 
+#include <cstddef>
 #include <vector>
 
 NS_CCR_BEGIN
 
 namespace Bazier
 {
+// Solves the curve with Cardano's method on every call. Kept as the reference for Evaluator.
 float computeBezier(const std::vector<float>& controlPoints, float ratio);
+
+// A cubic bezier easing from (0, 0) to (1, 1), preprocessed for fast evaluation.
+// The inverse of x(t) is tabulated once for each half of the curve; evaluating interpolates t from the table and
+// refines it with Newton steps kept inside the bracketing entries, so it needs no trigonometry or searching.
+// It stays within 1e-4 of a double precision solve; creator_reader_benchmark --check measures it.
+class Evaluator
+{
+public:
+	// The linear curve, cheap to build
+	Evaluator();
+
+	// `controlPoints` is {x1, y1, x2, y2}, like the curveData of a keyframe
+	explicit Evaluator(const std::vector<float>& controlPoints);
+
+	float evaluate(float ratio) const;
+
+	// Evaluates `count` ratios at once. The loop body has no branches depending on the ratios, so it can be vectorized.
+	void evaluate(const float* ratios, float* out, size_t count) const;
+
+private:
+	// Samples per half
+	static const int kSampleCount = 33;
+	static const int kIterations = 3;
+
+	// Curves with x1 near 1 and x2 near 0 have x(t) almost flat in the middle. Newton's step converges slowly there and
+	// floats cancel, so they are solved in double with more steps.
+	static const int kFlatIterations = 16;
+
+	// One half of the curve. x above 0.5 is solved on the curve mirrored through (0.5, 0.5), so that both ends, where
+	// x(t) may be flat, are solved close to t = 0 where floats are densest.
+	struct Half
+	{
+		// Polynomial coefficients of x(t) and y(t): ((a * t + b) * t + c) * t
+		float ax, bx, cx;
+		float ay, by, cy;
+
+		// t at x = w * w / 2, for w = i / (kSampleCount - 1). Spacing them by the square root keeps interpolating
+		// between them close where x(t) is flat at t = 0.
+		float samples[kSampleCount];
+	};
+
+	Half m_Halves[2];
+	bool m_FlatMiddle;
+
+	static void build(Half& half, float x1, float y1, float x2, float y2);
+};
 }
 
 NS_CCR_END
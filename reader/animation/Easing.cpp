@@ -330,84 +330,191 @@ float fade(float t)
 		return t * t * t * (t * (t * 6 - 15) + 10);
 }
 
-std::function<float(float)> makeOutIn(const std::function<float(float)>& fnIn, const std::function<float(float)>& fnOut)
+template <float (*fnIn)(float), float (*fnOut)(float)>
+float outIn(float k)
 {
-	return [=](float k) -> float {
-		if (k < 0.5f)
-			return fnOut(k * 2) / 2.f;
-		else
-			return fnIn(2.f * k - 1) / 2 + 0.5f;
-	};
+	if (k < 0.5f)
+		return fnOut(k * 2) / 2.f;
+	else
+		return fnIn(2.f * k - 1) / 2 + 0.5f;
 }
 
-static std::unordered_map<std::string, std::function<float(float)>> functions = {
-	{"constant", constant},
-	{"linear", linear},
+static const std::unordered_map<std::string, Type> types = {
+	{"constant", Type::Constant},
+	{"linear", Type::Linear},
 
-	{"quadIn", quadIn},
-	{"quadOut", quadOut},
-	{"quadInOut", quadInOut},
+	{"quadIn", Type::QuadIn},
+	{"quadOut", Type::QuadOut},
+	{"quadInOut", Type::QuadInOut},
 
-	{"cubicIn", cubicIn},
-	{"cubicOut", cubicOut},
-	{"cubicInOut", cubicInOut},
+	{"cubicIn", Type::CubicIn},
+	{"cubicOut", Type::CubicOut},
+	{"cubicInOut", Type::CubicInOut},
 
-	{"quart", quartIn},
-	{"quartOut", quartOut},
-	{"quartInOut", quartInOut},
+	{"quart", Type::QuartIn},
+	{"quartIn", Type::QuartIn},
+	{"quartOut", Type::QuartOut},
+	{"quartInOut", Type::QuartInOut},
 
-	{"quintIn", quintIn},
-	{"quintOut", quintOut},
-	{"quintInOut", quintInOut},
+	{"quintIn", Type::QuintIn},
+	{"quintOut", Type::QuintOut},
+	{"quintInOut", Type::QuintInOut},
 
-	{"sineIn", sineIn},
-	{"sineOut", sineOut},
-	{"sineInOut", sineInOut},
+	{"sineIn", Type::SineIn},
+	{"sineOut", Type::SineOut},
+	{"sineInOut", Type::SineInOut},
 
-	{"expoIn", expoIn},
-	{"expoOut", expoOut},
-	{"expoInOut", expoInOut},
+	{"expoIn", Type::ExpoIn},
+	{"expoOut", Type::ExpoOut},
+	{"expoInOut", Type::ExpoInOut},
 
-	{"circIn", circIn},
-	{"circOut", circOut},
-	{"circInOut", circInOut},
+	{"circIn", Type::CircIn},
+	{"circOut", Type::CircOut},
+	{"circInOut", Type::CircInOut},
 
-	{"elasticIn", elasticIn},
-	{"elasticOut", elasticOut},
-	{"elasticInOut", elasticInOut},
+	{"elasticIn", Type::ElasticIn},
+	{"elasticOut", Type::ElasticOut},
+	{"elasticInOut", Type::ElasticInOut},
 
-	{"backIn", backIn},
-	{"backOut", backOut},
-	{"backInOut", backInOut},
+	{"backIn", Type::BackIn},
+	{"backOut", Type::BackOut},
+	{"backInOut", Type::BackInOut},
 
-	{"bounceIn", bounceIn},
-	{"bounceOut", bounceOut},
-	{"bounceInOut", bounceInOut},
+	{"bounceIn", Type::BounceIn},
+	{"bounceOut", Type::BounceOut},
+	{"bounceInOut", Type::BounceInOut},
 
-	{"quadOutIn", makeOutIn(quadIn, quadOut)},
-	{"cubicOutIn", makeOutIn(cubicIn, cubicOut)},
-	{"quartOutIn", makeOutIn(quartIn, quartOut)},
-	{"quintOutIn", makeOutIn(quintIn, quintOut)},
-	{"sineOutIn", makeOutIn(sineIn, sineOut)},
-	{"expoOutIn", makeOutIn(expoIn, expoOut)},
-	{"circOutIn", makeOutIn(circIn, circOut)},
-	{"backOutIn", makeOutIn(backIn, backOut)},
-	{"backOutIn", makeOutIn(bounceIn, bounceOut)},
+	{"quadOutIn", Type::QuadOutIn},
+	{"cubicOutIn", Type::CubicOutIn},
+	{"quartOutIn", Type::QuartOutIn},
+	{"quintOutIn", Type::QuintOutIn},
+	{"sineOutIn", Type::SineOutIn},
+	{"expoOutIn", Type::ExpoOutIn},
+	{"circOutIn", Type::CircOutIn},
+	{"backOutIn", Type::BackOutIn},
+	{"bounceOutIn", Type::BounceOutIn},
 
-	{"smooth", smooth},
-	{"fade", fade}};
+	{"smooth", Type::Smooth},
+	{"fade", Type::Fade}};
 
-std::function<float(float)> getFunction(const std::string& type)
+Type getType(const std::string& name)
 {
-	if (functions.find(type) != functions.end())
-		return functions[type];
+	if (name.empty())
+		return Type::Linear;
+
+	auto it = types.find(name);
+	if (it != types.end())
+		return it->second;
 	else
 	{
 		// it is a bug here
 		assert(false);
-		return linear;
+		return Type::Linear;
 	}
 }
+
+float evaluate(Type type, float k)
+{
+	switch (type)
+	{
+	case Type::Linear:
+		return k;
+	case Type::Constant:
+		return constant(k);
+	case Type::QuadIn:
+		return quadIn(k);
+	case Type::QuadOut:
+		return quadOut(k);
+	case Type::QuadInOut:
+		return quadInOut(k);
+	case Type::CubicIn:
+		return cubicIn(k);
+	case Type::CubicOut:
+		return cubicOut(k);
+	case Type::CubicInOut:
+		return cubicInOut(k);
+	case Type::QuartIn:
+		return quartIn(k);
+	case Type::QuartOut:
+		return quartOut(k);
+	case Type::QuartInOut:
+		return quartInOut(k);
+	case Type::QuintIn:
+		return quintIn(k);
+	case Type::QuintOut:
+		return quintOut(k);
+	case Type::QuintInOut:
+		return quintInOut(k);
+	case Type::SineIn:
+		return sineIn(k);
+	case Type::SineOut:
+		return sineOut(k);
+	case Type::SineInOut:
+		return sineInOut(k);
+	case Type::ExpoIn:
+		return expoIn(k);
+	case Type::ExpoOut:
+		return expoOut(k);
+	case Type::ExpoInOut:
+		return expoInOut(k);
+	case Type::CircIn:
+		return circIn(k);
+	case Type::CircOut:
+		return circOut(k);
+	case Type::CircInOut:
+		return circInOut(k);
+	case Type::ElasticIn:
+		return elasticIn(k);
+	case Type::ElasticOut:
+		return elasticOut(k);
+	case Type::ElasticInOut:
+		return elasticInOut(k);
+	case Type::BackIn:
+		return backIn(k);
+	case Type::BackOut:
+		return backOut(k);
+	case Type::BackInOut:
+		return backInOut(k);
+	case Type::BounceIn:
+		return bounceIn(k);
+	case Type::BounceOut:
+		return bounceOut(k);
+	case Type::BounceInOut:
+		return bounceInOut(k);
+	case Type::QuadOutIn:
+		return outIn<quadIn, quadOut>(k);
+	case Type::CubicOutIn:
+		return outIn<cubicIn, cubicOut>(k);
+	case Type::QuartOutIn:
+		return outIn<quartIn, quartOut>(k);
+	case Type::QuintOutIn:
+		return outIn<quintIn, quintOut>(k);
+	case Type::SineOutIn:
+		return outIn<sineIn, sineOut>(k);
+	case Type::ExpoOutIn:
+		return outIn<expoIn, expoOut>(k);
+	case Type::CircOutIn:
+		return outIn<circIn, circOut>(k);
+	case Type::BackOutIn:
+		return outIn<backIn, backOut>(k);
+	case Type::BounceOutIn:
+		return outIn<bounceIn, bounceOut>(k);
+	case Type::Smooth:
+		return smooth(k);
+	case Type::Fade:
+		return fade(k);
+	default:
+		return k;
+	}
+}
+
+std::function<float(float)> getFunction(const std::string& type)
+{
+	const Type resolved = getType(type);
+	return [resolved](float k) -> float {
+		return evaluate(resolved, k);
+	};
+}
 } // namespace Easing
 
 NS_CCR_END
@@ -25,6 +25,7 @@
 
 #include "../Macros.h"
 
+#include <cstdint>
 #include <functional>
 #include <string>
 
@@ -32,6 +33,59 @@ NS_CCR_BEGIN
 
 namespace Easing
 {
+enum class Type : uint8_t
+{
+	Linear,
+	Constant,
+	QuadIn,
+	QuadOut,
+	QuadInOut,
+	CubicIn,
+	CubicOut,
+	CubicInOut,
+	QuartIn,
+	QuartOut,
+	QuartInOut,
+	QuintIn,
+	QuintOut,
+	QuintInOut,
+	SineIn,
+	SineOut,
+	SineInOut,
+	ExpoIn,
+	ExpoOut,
+	ExpoInOut,
+	CircIn,
+	CircOut,
+	CircInOut,
+	ElasticIn,
+	ElasticOut,
+	ElasticInOut,
+	BackIn,
+	BackOut,
+	BackInOut,
+	BounceIn,
+	BounceOut,
+	BounceInOut,
+	QuadOutIn,
+	CubicOutIn,
+	QuartOutIn,
+	QuintOutIn,
+	SineOutIn,
+	ExpoOutIn,
+	CircOutIn,
+	BackOutIn,
+	BounceOutIn,
+	Smooth,
+	Fade
+};
+
+// Resolves a Creator curve type name, an empty name is linear. Meant to be called while loading.
+Type getType(const std::string& name);
+
+// Eases `ratio` (0-1) with the given easing
+float evaluate(Type type, float ratio);
+
 std::function<float(float)> getFunction(const std::string& type);
 }
 
@@ -0,0 +1,387 @@
+// Headless benchmarks of the animation code: easings, bezier curves, keyframe lookup and AnimationManager ticks.
+// Nothing is rendered, so no GL context or window is needed. Results are printed as JSON, to compare against a
+// baseline run:
+//
+//   creator_reader_benchmark [--quick] [output.json]
+//
+// `ns_per_op` is the time of one easing/curve/key evaluation, or of one whole tick for the manager benchmarks.
+//
+// With --check, it runs the accuracy checks instead and exits with 1 if any of them fails:
+//
+//   creator_reader_benchmark --check
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "cocos2d.h"
+
+#include "CreatorReader.h"
+#include "animation/AnimationClip.h"
+#include "animation/AnimationManager.h"
+#include "animation/Bezier.h"
+#include "animation/Easing.h"
+
+USING_NS_CCR;
+
+namespace
+{
+struct Result
+{
+	std::string name;
+	uint64_t ops;
+	double nsPerOp;
+};
+
+// Keeps the compiler from dropping results nobody reads
+volatile float g_Sink = 0;
+
+// Evaluations per timed call, so that reading the clock stays out of the measurement
+const size_t kBatchSize = 1024;
+
+double g_MinSeconds = 0.25;
+std::vector<Result> g_Results;
+
+// Calls `run` (which does `opsPerRun` operations) until g_MinSeconds have passed, after a warm up call
+template <typename F>
+void measure(const std::string& name, uint64_t opsPerRun, F&& run)
+{
+	typedef std::chrono::steady_clock Clock;
+
+	run();
+
+	uint64_t runs = 0;
+	const auto start = Clock::now();
+	double seconds = 0;
+	do
+	{
+		run();
+		++runs;
+		seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	} while (seconds < g_MinSeconds);
+
+	const uint64_t ops = runs * opsPerRun;
+	g_Results.push_back({name, ops, seconds * 1e9 / ops});
+	fprintf(stderr, "%-40s %12.2f ns/op\n", name.c_str(), seconds * 1e9 / ops);
+}
+
+std::vector<float> makeRatios(size_t count)
+{
+	std::vector<float> ratios(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		ratios[i] = static_cast<float>(i) / (count - 1);
+	}
+
+	return ratios;
+}
+
+void benchmarkEasings()
+{
+	static const char* const names[] = {
+		"linear", "constant", "quadIn", "quadOut", "quadInOut", "cubicIn", "cubicOut", "cubicInOut", "quartIn", "quartOut",
+		"quartInOut", "quintIn", "quintOut", "quintInOut", "sineIn", "sineOut", "sineInOut", "expoIn", "expoOut",
+		"expoInOut", "circIn", "circOut", "circInOut", "elasticIn", "elasticOut", "elasticInOut", "backIn", "backOut",
+		"backInOut", "bounceIn", "bounceOut", "bounceInOut", "quadOutIn", "cubicOutIn", "quartOutIn", "quintOutIn",
+		"sineOutIn", "expoOutIn", "circOutIn", "backOutIn", "bounceOutIn", "smooth", "fade"};
+
+	const auto ratios = makeRatios(kBatchSize);
+	for (const char* name : names)
+	{
+		const Easing::Type type = Easing::getType(name);
+		measure(std::string("easing/") + name, kBatchSize, [&]() {
+			float sum = 0;
+			for (float ratio : ratios)
+			{
+				sum += Easing::evaluate(type, ratio);
+			}
+			g_Sink = sum;
+		});
+	}
+}
+
+void benchmarkBezier()
+{
+	const auto ratios = makeRatios(kBatchSize);
+	const std::vector<float> controlPoints = {0.25f, 0.1f, 0.25f, 1.f};
+
+	measure("bezier/computeBezier", kBatchSize, [&]() {
+		float sum = 0;
+		for (float ratio : ratios)
+		{
+			sum += Bazier::computeBezier(controlPoints, ratio);
+		}
+		g_Sink = sum;
+	});
+
+	const Bazier::Evaluator evaluator(controlPoints);
+	measure("bezier/evaluator", kBatchSize, [&]() {
+		float sum = 0;
+		for (float ratio : ratios)
+		{
+			sum += evaluator.evaluate(ratio);
+		}
+		g_Sink = sum;
+	});
+}
+
+// y at x on the curve, solved in double precision by bisection. The reference the checks compare against.
+double referenceBezier(const std::vector<float>& controlPoints, double x)
+{
+	const double cx = 3.0 * controlPoints[0], bx = 3.0 * (controlPoints[2] - controlPoints[0]) - cx, ax = 1 - cx - bx;
+	const double cy = 3.0 * controlPoints[1], by = 3.0 * (controlPoints[3] - controlPoints[1]) - cy, ay = 1 - cy - by;
+
+	double lo = 0, hi = 1;
+	for (int i = 0; i < 80; ++i)
+	{
+		const double t = 0.5 * (lo + hi);
+		if (((ax * t + bx) * t + cx) * t < x)
+			lo = t;
+		else
+			hi = t;
+	}
+
+	const double t = 0.5 * (lo + hi);
+	return ((ay * t + by) * t + cy) * t;
+}
+
+// Compares Bazier::Evaluator, one ratio at a time and batched, against the reference and against computeBezier
+bool checkBezier()
+{
+	// Largest errors accepted against the reference
+	const double kMaxEvaluatorError = 1e-4;
+	const double kMaxComputeBezierError = 5e-3;
+
+	// Creator's presets, and curves overshooting in y (back-like), vertical at the ends or vertical in the middle
+	const std::vector<std::vector<float>> curves = {
+		{0.25f, 0.1f, 0.25f, 1.f}, {0.42f, 0.f, 1.f, 1.f}, {0.f, 0.f, 0.58f, 1.f}, {0.42f, 0.f, 0.58f, 1.f},
+		{0.68f, -0.55f, 0.265f, 1.55f}, {0.f, 1.f, 0.f, 1.f}, {1.f, 0.f, 1.f, 0.f}, {0.01f, 0.99f, 0.99f, 0.01f},
+		{0.5f, 0.5f, 0.5f, 0.5f}, {0.175f, 0.885f, 0.32f, 1.275f}, {1.f, 0.f, 0.f, 1.f}, {0.98f, 0.1f, 0.01f, 0.9f}};
+
+	const auto ratios = makeRatios(10001);
+	std::vector<float> batched(ratios.size());
+
+	bool passed = true;
+	for (const auto& curve : curves)
+	{
+		const Bazier::Evaluator evaluator(curve);
+		evaluator.evaluate(ratios.data(), batched.data(), ratios.size());
+
+		double evaluatorError = 0, batchError = 0, computeBezierError = 0, evaluatorToComputeBezier = 0;
+		for (size_t i = 0; i < ratios.size(); ++i)
+		{
+			const double reference = referenceBezier(curve, ratios[i]);
+			const float single = evaluator.evaluate(ratios[i]);
+			const float cardano = Bazier::computeBezier(curve, ratios[i]);
+
+			evaluatorError = std::max(evaluatorError, std::fabs(single - reference));
+			batchError = std::max(batchError, std::fabs(batched[i] - reference));
+			computeBezierError = std::max(computeBezierError, std::fabs(cardano - reference));
+			evaluatorToComputeBezier = std::max(evaluatorToComputeBezier, static_cast<double>(std::fabs(single - cardano)));
+		}
+
+		const bool ok = evaluatorError <= kMaxEvaluatorError && batchError <= kMaxEvaluatorError && computeBezierError <= kMaxComputeBezierError;
+		passed = passed && ok;
+
+		fprintf(stderr, "bezier {%g, %g, %g, %g}: evaluator %.2e, batch %.2e, computeBezier %.2e, evaluator - computeBezier %.2e %s\n",
+				curve[0], curve[1], curve[2], curve[3], evaluatorError, batchError, computeBezierError, evaluatorToComputeBezier, ok ? "ok" : "FAILED");
+	}
+
+	return passed;
+}
+
+// A looping clip moving its node through `keyCount` keys. With curves, it also fades and scales it, and the segments
+// use a mix of easings.
+AnimationClip* makeClip(size_t keyCount, float keysPerSecond, bool withCurves)
+{
+	static const char* const curves[] = {"", "quadInOut", "cubicOut", "sineIn"};
+	const std::vector<float> none;
+
+	auto clip = AnimationClip::create();
+	clip->setName("benchmark");
+	clip->setSpeed(1);
+	clip->setSample(60);
+	clip->setWrapMode(AnimationClip::WrapMode::Loop);
+	clip->setDuration((keyCount - 1) / keysPerSecond);
+
+	clip->addTrackSet("");
+	for (size_t i = 0; i < keyCount; ++i)
+	{
+		const float value = static_cast<float>(i % 7) * 10;
+		clip->addKey(AnimTrackType::PositionX, i / keysPerSecond, &value, withCurves ? curves[i % 4] : "", none);
+	}
+
+	if (withCurves)
+	{
+		for (size_t i = 0; i < keyCount; ++i)
+		{
+			const float opacity = static_cast<float>(i % 2) * 255;
+			clip->addKey(AnimTrackType::Opacity, i / keysPerSecond, &opacity, curves[(i + 1) % 4], none);
+		}
+
+		for (size_t i = 0; i < keyCount; ++i)
+		{
+			const float scale = 1 + static_cast<float>(i % 3) * 0.25f;
+			clip->addKey(AnimTrackType::ScaleX, i / keysPerSecond, &scale, curves[(i + 2) % 4], none);
+		}
+	}
+
+	return clip;
+}
+
+void benchmarkKeyframes()
+{
+	std::mt19937 random(42);
+
+	for (size_t keyCount : {4, 16, 64, 256, 1024, 4096})
+	{
+		auto clip = makeClip(keyCount, 10, false);
+		clip->retain();
+
+		const AnimTrack& track = clip->getTracks()[0];
+		const float duration = clip->getDuration();
+
+		// Playback: a frame at a time, the cursor moves by a key at most
+		std::vector<float> sequential(kBatchSize);
+		for (size_t i = 0; i < kBatchSize; ++i)
+		{
+			sequential[i] = std::fmod(i / 60.f, duration);
+		}
+
+		// Seeks: every lookup lands somewhere else
+		std::uniform_real_distribution<float> anywhere(0, duration);
+		std::vector<float> seeks(kBatchSize);
+		for (auto& time : seeks)
+		{
+			time = anywhere(random);
+		}
+
+		const std::string prefix = "keyframes/" + std::to_string(keyCount);
+		for (const auto& times : {std::make_pair("/sequential", &sequential), std::make_pair("/random", &seeks)})
+		{
+			int cursor = 0;
+			measure(prefix + times.first, kBatchSize, [&]() {
+				float value = 0, sum = 0;
+				for (float time : *times.second)
+				{
+					clip->evaluate(track, time, cursor, &value);
+					sum += value;
+				}
+				g_Sink = sum;
+			});
+		}
+
+		clip->release();
+	}
+}
+
+// `clipCount` clips of a few eased tracks, spread over `nodeCount` nodes, ticked through the cocos scheduler
+void benchmarkManager(AnimationManager* manager, size_t clipCount, size_t nodeCount, unsigned int threads)
+{
+	auto scheduler = cocos2d::Director::getInstance()->getScheduler();
+	manager->setEvaluationThreads(threads);
+
+	std::vector<cocos2d::Node*> nodes;
+	for (size_t i = 0; i < nodeCount; ++i)
+	{
+		auto node = cocos2d::Node::create();
+		node->retain();
+		nodes.push_back(node);
+	}
+
+	std::vector<AnimationClip*> clips;
+	for (size_t i = 0; i < clipCount; ++i)
+	{
+		auto clip = makeClip(8 + i % 5, 4, true);
+		clip->retain();
+		clips.push_back(clip);
+
+		manager->playAnimationClip(nodes[i % nodeCount], clip);
+	}
+
+	const std::string name = "manager/" + std::to_string(clipCount) + "x" + std::to_string(nodeCount) + (threads == 1 ? "/serial" : "/parallel");
+	measure(name, 1, [&]() {
+		scheduler->update(1 / 60.f);
+	});
+
+	for (size_t i = 0; i < clipCount; ++i)
+	{
+		manager->stopAnimationClip(nodes[i % nodeCount], clips[i], false);
+		clips[i]->release();
+	}
+
+	// Removes the stopped playbacks
+	scheduler->update(0);
+
+	for (auto node : nodes)
+	{
+		node->release();
+	}
+}
+
+void writeResults(FILE* file)
+{
+	fprintf(file, "{\n  \"benchmarks\": [\n");
+	for (size_t i = 0; i < g_Results.size(); ++i)
+	{
+		const Result& result = g_Results[i];
+		fprintf(file, "    {\"name\": \"%s\", \"ops\": %llu, \"ns_per_op\": %.3f}%s\n", result.name.c_str(),
+				static_cast<unsigned long long>(result.ops), result.nsPerOp, i + 1 < g_Results.size() ? "," : "");
+	}
+	fprintf(file, "  ]\n}\n");
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+	const char* outputPath = nullptr;
+	bool check = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--quick") == 0)
+			g_MinSeconds = 0.02;
+		else if (std::strcmp(argv[i], "--check") == 0)
+			check = true;
+		else
+			outputPath = argv[i];
+	}
+
+	if (check)
+		return checkBezier() ? 0 : 1;
+
+	benchmarkEasings();
+	benchmarkBezier();
+	benchmarkKeyframes();
+
+	{
+		// The reader owns the manager; neither needs a GL view
+		Reader reader;
+		auto manager = reader.getAnimationManager();
+
+		const size_t sizes[][2] = {{100, 100}, {500, 100}, {2000, 500}};
+		for (const auto& size : sizes)
+		{
+			benchmarkManager(manager, size[0], size[1], 1);
+			benchmarkManager(manager, size[0], size[1], 0);
+		}
+	}
+
+	FILE* file = outputPath ? fopen(outputPath, "w") : stdout;
+	if (!file)
+	{
+		fprintf(stderr, "Cannot write %s\n", outputPath);
+		return 1;
+	}
+
+	writeResults(file);
+	if (file != stdout)
+		fclose(file);
+
+	return 0;
+}
@@ -0,0 +1,317 @@
+#include "AnimationClipCache.h"
+
+#include <algorithm>
+#include <iterator>
+
+NS_CCR_BEGIN
+
+namespace
+{
+// Key values of each kind of property, as the `AnimTrack::components` floats the clip stores
+template <typename P>
+void readAnimValue(const P* fbProp, float* value)
+{
+	value[0] = static_cast<float>(fbProp->value());
+}
+
+void readAnimValue(const buffers::AnimPropPosition* fbProp, float* value)
+{
+	value[0] = fbProp->value()->x();
+	value[1] = fbProp->value()->y();
+}
+
+void readAnimValue(const buffers::AnimPropColor* fbProp, float* value)
+{
+	value[0] = static_cast<float>(fbProp->value()->r());
+	value[1] = static_cast<float>(fbProp->value()->g());
+	value[2] = static_cast<float>(fbProp->value()->b());
+}
+
+// Calls `visitor(list, type)` with every property list of a node, in the order they have always been read in
+template <typename Visitor>
+void visitAnimProps(const buffers::AnimProps* fbAnimProps, Visitor& visitor)
+{
+	visitor(fbAnimProps->position(), AnimTrackType::Position);
+	visitor(fbAnimProps->positionX(), AnimTrackType::PositionX);
+	visitor(fbAnimProps->positionY(), AnimTrackType::PositionY);
+	visitor(fbAnimProps->rotation(), AnimTrackType::Rotation);
+	visitor(fbAnimProps->skewX(), AnimTrackType::SkewX);
+	visitor(fbAnimProps->skewY(), AnimTrackType::SkewY);
+	visitor(fbAnimProps->scaleX(), AnimTrackType::ScaleX);
+	visitor(fbAnimProps->scaleY(), AnimTrackType::ScaleY);
+	visitor(fbAnimProps->color(), AnimTrackType::Color);
+	visitor(fbAnimProps->opacity(), AnimTrackType::Opacity);
+	visitor(fbAnimProps->anchorX(), AnimTrackType::AnchorX);
+	visitor(fbAnimProps->anchorY(), AnimTrackType::AnchorY);
+	visitor(fbAnimProps->active(), AnimTrackType::Active);
+	visitor(fbAnimProps->width(), AnimTrackType::Width);
+	visitor(fbAnimProps->height(), AnimTrackType::Height);
+	visitor(fbAnimProps->spriteFrame(), AnimTrackType::SpriteFrame);
+}
+
+// First pass: sizes of the clip's arrays, so that each of them is allocated once
+struct AnimKeyCounter
+{
+	size_t tracks = 0;
+	size_t keys = 0;
+	size_t values = 0;
+
+	template <typename T>
+	void operator()(T fbPropList, AnimTrackType type)
+	{
+		if (fbPropList && fbPropList->size() > 0)
+		{
+			++tracks;
+			keys += fbPropList->size();
+			values += fbPropList->size() * AnimationClip::getComponentCount(type);
+		}
+	}
+};
+
+// Second pass: adds the keys. The curve of a key is read into buffers reused for the whole clip.
+struct AnimKeyReader
+{
+	AnimationClip* clip;
+	std::string curveType;
+	std::vector<float> curveData;
+
+	template <typename T>
+	void operator()(T fbPropList, AnimTrackType type)
+	{
+		if (fbPropList)
+		{
+			for (const auto fbProp : *fbPropList)
+			{
+				this->readCurve(fbProp);
+				this->addKey(fbProp, type);
+			}
+		}
+	}
+
+	template <typename P>
+	void readCurve(const P* fbProp)
+	{
+		const auto fbCurveType = fbProp->curveType();
+		curveType = fbCurveType ? fbCurveType->c_str() : "";
+
+		curveData.clear();
+		const auto fbCurveData = fbProp->curveData();
+		if (fbCurveData)
+			curveData.insert(curveData.end(), fbCurveData->begin(), fbCurveData->end());
+	}
+
+	template <typename P>
+	void addKey(const P* fbProp, AnimTrackType type)
+	{
+		float value[3];
+		readAnimValue(fbProp, value);
+		clip->addKey(type, fbProp->frame(), value, curveType, curveData);
+	}
+
+	void addKey(const buffers::AnimPropSpriteFrame* fbProp, AnimTrackType type)
+	{
+		clip->addKey(type, fbProp->frame(), fbProp->value()->str(), curveType, curveData);
+	}
+};
+} // namespace
+
+AnimationClipCache* AnimationClipCache::instance = nullptr;
+
+AnimationClipCache::AnimationClipCache() :
+	m_BakeSampleRate(-1)
+{
+	AnimationClipCache::instance = this;
+}
+
+AnimationClipCache::~AnimationClipCache()
+{
+	this->RemoveAnimationClips();
+	AnimationClipCache::instance = nullptr;
+}
+
+AnimationClip* AnimationClipCache::GetAnimationClip(const std::string& name)
+{
+	AnimationClip* clip = nullptr;
+	if (m_Clips.Find(name, clip))
+		return clip;
+
+	clip = this->Load(name);
+	if (!clip)
+		return nullptr;
+
+	const float bakeSampleRate = this->GetBakeSampleRate(name);
+	if (bakeSampleRate >= 0)
+		clip->bake(bakeSampleRate);
+
+	// Another thread may have loaded the same clip in the meantime, everyone gets the first one stored
+	if (!m_Clips.Emplace(name, clip))
+	{
+		clip->release();
+		m_Clips.Find(name, clip);
+	}
+
+	return clip;
+}
+
+AnimationClip* AnimationClipCache::Load(const std::string& name) const
+{
+	cocos2d::FileUtils* fileUtils = cocos2d::FileUtils::getInstance();
+	std::string fullpath = fileUtils->fullPathForFilename(std::string("animations/").append(name).append(".anim"));
+	if (fullpath.empty())
+		return nullptr;
+
+	cocos2d::Data data = fileUtils->getDataFromFile(fullpath);
+	if (data.isNull())
+		return nullptr;
+
+	// Not autoreleased, this may run on a loader thread
+	auto clip = new (std::nothrow) AnimationClip;
+	if (!clip || !clip->init())
+	{
+		delete clip;
+		return nullptr;
+	}
+
+	AnimationClipCache::Parse(buffers::GetAnimationClip(data.getBytes()), clip);
+	return clip;
+}
+
+void AnimationClipCache::Parse(const buffers::AnimationClip* fbAnimationClip, AnimationClip* animClip)
+{
+	animClip->setDuration(fbAnimationClip->duration());
+	animClip->setSpeed(fbAnimationClip->speed());
+	animClip->setSample(fbAnimationClip->sample());
+	animClip->setName(fbAnimationClip->name()->str());
+	animClip->setWrapMode(static_cast<AnimationClip::WrapMode>(fbAnimationClip->wrapMode()));
+
+	const auto& curveDatas = fbAnimationClip->curveData();
+
+	AnimKeyCounter counter;
+	size_t trackSetCount = 0;
+	for (const auto& fbCurveData : *curveDatas)
+	{
+		if (fbCurveData)
+		{
+			++trackSetCount;
+			visitAnimProps(fbCurveData->props(), counter);
+		}
+	}
+
+	animClip->reserve(trackSetCount, counter.tracks, counter.keys, counter.values);
+
+	AnimKeyReader reader;
+	reader.clip = animClip;
+	for (const auto& fbCurveData : *curveDatas)
+	{
+		if (fbCurveData)
+		{
+			// path: self's animation doesn't have path
+			// path is used for sub node
+			animClip->addTrackSet(fbCurveData->path() ? fbCurveData->path()->str() : "");
+			visitAnimProps(fbCurveData->props(), reader);
+		}
+	}
+
+	animClip->endKeys();
+
+	// Events, their parameters are read once here
+	const auto fbEvents = fbAnimationClip->events();
+	if (fbEvents)
+	{
+		std::vector<std::string> params;
+		for (const auto fbEvent : *fbEvents)
+		{
+			params.clear();
+			if (fbEvent->params())
+			{
+				for (const auto fbParam : *fbEvent->params())
+				{
+					params.push_back(fbParam->str());
+				}
+			}
+
+			animClip->addEvent(fbEvent->frame(), fbEvent->func() ? fbEvent->func()->str() : "", params);
+		}
+	}
+}
+
+float AnimationClipCache::GetBakeSampleRate(const std::string& name) const
+{
+	std::lock_guard<std::mutex> lock(m_BakeMutex);
+
+	auto it = m_ClipBakeSampleRates.find(name);
+	return it != m_ClipBakeSampleRates.end() ? it->second : m_BakeSampleRate;
+}
+
+void AnimationClipCache::SetBakeSampleRate(float sampleRate)
+{
+	std::lock_guard<std::mutex> lock(m_BakeMutex);
+	m_BakeSampleRate = sampleRate;
+}
+
+void AnimationClipCache::SetBakeSampleRate(const std::string& name, float sampleRate)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_BakeMutex);
+		m_ClipBakeSampleRates[name] = sampleRate;
+	}
+
+	AnimationClip* clip = nullptr;
+	if (m_Clips.Find(name, clip))
+		clip->bake(sampleRate);
+}
+
+void AnimationClipCache::PreloadAnimationClips(const std::vector<std::string>& names, const std::function<void()>& callback)
+{
+	this->JoinPreloadThreads(false);
+
+	std::unique_ptr<PreloadThread> preload(new PreloadThread);
+	PreloadThread* state = preload.get();
+	preload->thread = std::thread([this, state, names, callback]() {
+		for (const auto& name : names)
+		{
+			this->GetAnimationClip(name);
+		}
+
+		if (callback)
+			cocos2d::Director::getInstance()->getScheduler()->performFunctionInCocosThread(callback);
+
+		state->done = true;
+	});
+
+	std::lock_guard<std::mutex> lock(m_PreloadMutex);
+	m_PreloadThreads.push_back(std::move(preload));
+}
+
+void AnimationClipCache::JoinPreloadThreads(bool all)
+{
+	// Joined outside of the lock, a preload may take a while to finish
+	std::vector<std::unique_ptr<PreloadThread>> joined;
+	{
+		std::lock_guard<std::mutex> lock(m_PreloadMutex);
+		auto it = std::partition(m_PreloadThreads.begin(), m_PreloadThreads.end(), [all](const std::unique_ptr<PreloadThread>& preload) {
+			return !all && !preload->done;
+		});
+
+		std::move(it, m_PreloadThreads.end(), std::back_inserter(joined));
+		m_PreloadThreads.erase(it, m_PreloadThreads.end());
+	}
+
+	for (auto& preload : joined)
+	{
+		preload->thread.join();
+	}
+}
+
+void AnimationClipCache::RemoveAnimationClips()
+{
+	this->JoinPreloadThreads(true);
+
+	m_Clips.ForEach([](const std::string&, AnimationClip* clip) {
+		clip->release();
+	});
+
+	m_Clips.Clear();
+}
+
+NS_CCR_END
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "cocos2d.h"
+
+#include "../Animation_generated.h"
+#include "../Macros.h"
+#include "../animation/AnimationClip.h"
+#include "ShardedMap.h"
+
+NS_CCR_BEGIN
+
+class Reader;
+
+// Clips of the .anim files, each read and built once and then shared by every node and load referring to it
+class AnimationClipCache
+{
+	friend class Reader;
+
+private:
+	// Retained clips by the name nodes refer to them with (animations/<name>.anim). Readable from any thread.
+	ShardedMap<AnimationClip*> m_Clips;
+
+	// Rates clips are baked at when loaded, see SetBakeSampleRate
+	mutable std::mutex m_BakeMutex;
+	float m_BakeSampleRate;
+	std::unordered_map<std::string, float> m_ClipBakeSampleRates;
+
+	// Threads of PreloadAnimationClips, joined before the clips are dropped so none of them outlives the cache
+	struct PreloadThread
+	{
+		std::thread thread;
+		std::atomic<bool> done{false};
+	};
+
+	std::mutex m_PreloadMutex;
+	std::vector<std::unique_ptr<PreloadThread>> m_PreloadThreads;
+
+	static AnimationClipCache* instance;
+
+	// @return A new clip (retained, not autoreleased), or nullptr if the file is missing. Safe off the cocos thread.
+	AnimationClip* Load(const std::string& name) const;
+	// @param all	Whether to wait for the running preloads too, or only reap the finished ones
+	void JoinPreloadThreads(bool all);
+	float GetBakeSampleRate(const std::string& name) const;
+	static void Parse(const buffers::AnimationClip* fbAnimationClip, AnimationClip* animClip);
+
+public:
+	inline static AnimationClipCache* i() { return AnimationClipCache::instance; }
+	AnimationClipCache();
+	~AnimationClipCache();
+
+	/**
+	 Returns the clip, loading it if this is the first time it is asked for. Can be called from any thread.
+	 @return The shared clip, owned by the cache; nullptr if its file does not exist
+	 */
+	AnimationClip* GetAnimationClip(const std::string& name);
+
+	/**
+	 Loads clips on a worker thread, so that nodes referring to them later find them in the cache.
+	 RemoveAnimationClips and the destructor wait for the thread to finish.
+	 @param callback	Called on the cocos thread once all of them are loaded
+	 */
+	void PreloadAnimationClips(const std::vector<std::string>& names, const std::function<void()>& callback = nullptr);
+
+	/**
+	 Bakes clips loaded from now on (see AnimationClip::bake), trading memory for cheaper playback. Off by default.
+	 @param sampleRate	Samples per second, 0 for each clip's own sample rate, negative to stop baking
+	 */
+	void SetBakeSampleRate(float sampleRate);
+
+	// Same as above for one clip, taking precedence. A clip already loaded is baked again right away, so this has
+	// to be called on the cocos thread if it may be playing.
+	void SetBakeSampleRate(const std::string& name, float sampleRate);
+
+	// Drops the cache's references, after waiting for running preloads. Clips still in use stay alive until their
+	// users release them.
+	void RemoveAnimationClips();
+};
+
+NS_CCR_END
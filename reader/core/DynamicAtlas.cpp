@@ -0,0 +1,287 @@
+#include "DynamicAtlas.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+NS_CCR_BEGIN
+
+namespace
+{
+// Each packed image is surrounded by a border of its own edge pixels so that
+// linear filtering never samples a neighbouring image
+const int kBorder = 1;
+const int kBytesPerPixel = 4;
+} // namespace
+
+DynamicAtlas::DynamicAtlas() :
+#if CC_ENABLE_CACHE_TEXTURE_DATA
+	m_RecreatedListener(nullptr),
+#endif
+	m_PageSize(1024),
+	m_MaxSpriteSize(256)
+{
+}
+
+DynamicAtlas::~DynamicAtlas()
+{
+	this->Clear();
+}
+
+void DynamicAtlas::Clear()
+{
+	for (auto& page : m_Pages)
+	{
+		CC_SAFE_RELEASE(page.texture);
+	}
+
+	m_Pages.clear();
+
+#if CC_ENABLE_CACHE_TEXTURE_DATA
+	if (m_RecreatedListener)
+	{
+		cocos2d::Director::getInstance()->getEventDispatcher()->removeEventListener(m_RecreatedListener);
+		m_RecreatedListener = nullptr;
+	}
+#endif
+}
+
+DynamicAtlas::Page* DynamicAtlas::CreatePage(bool premultipliedAlpha)
+{
+	std::vector<unsigned char> pixels(static_cast<size_t>(m_PageSize) * m_PageSize * kBytesPerPixel, 0);
+
+	auto image = new (std::nothrow) cocos2d::Image();
+	if (!image || !image->initWithRawData(pixels.data(), pixels.size(), m_PageSize, m_PageSize, 8, premultipliedAlpha))
+	{
+		CC_SAFE_RELEASE(image);
+		return nullptr;
+	}
+
+	auto texture = new (std::nothrow) cocos2d::Texture2D();
+	bool initialized = texture && texture->initWithImage(image, cocos2d::Texture2D::PixelFormat::RGBA8888);
+	image->release();
+
+	if (!initialized)
+	{
+		CC_SAFE_RELEASE(texture);
+		return nullptr;
+	}
+
+	Page page;
+	page.texture = texture;
+	page.premultipliedAlpha = premultipliedAlpha;
+	page.skyline.push_back({0, 0, m_PageSize});
+#if CC_ENABLE_CACHE_TEXTURE_DATA
+	page.pixels = std::move(pixels);
+
+	if (!m_RecreatedListener)
+	{
+		m_RecreatedListener = cocos2d::Director::getInstance()->getEventDispatcher()->addCustomEventListener(EVENT_RENDERER_RECREATED, [this](cocos2d::EventCustom*) {
+			for (auto& page : m_Pages)
+			{
+				page.texture->updateWithData(page.pixels.data(), 0, 0, m_PageSize, m_PageSize);
+			}
+		});
+	}
+#endif
+	m_Pages.push_back(std::move(page));
+
+	return &m_Pages.back();
+}
+
+int DynamicAtlas::Fits(const Page& page, size_t index, int width, int height) const
+{
+	int x = page.skyline[index].x;
+	if (x + width > m_PageSize)
+		return -1;
+
+	// The skyline always spans the whole page width, so this never runs past the last node
+	int y = page.skyline[index].y;
+	int remaining = width;
+	for (size_t i = index; remaining > 0; ++i)
+	{
+		y = std::max(y, page.skyline[i].y);
+		if (y + height > m_PageSize)
+			return -1;
+
+		remaining -= page.skyline[i].width;
+	}
+
+	return y;
+}
+
+bool DynamicAtlas::Insert(Page& page, int width, int height, int& x, int& y)
+{
+	int bestIndex = -1;
+	int bestBottom = INT_MAX;
+	int bestWidth = INT_MAX;
+
+	// Bottom-left rule: lowest resulting top edge, ties broken by the narrowest skyline segment
+	for (size_t i = 0; i < page.skyline.size(); ++i)
+	{
+		int top = this->Fits(page, i, width, height);
+		if (top < 0)
+			continue;
+
+		int bottom = top + height;
+		if (bottom < bestBottom || (bottom == bestBottom && page.skyline[i].width < bestWidth))
+		{
+			bestIndex = static_cast<int>(i);
+			bestBottom = bottom;
+			bestWidth = page.skyline[i].width;
+			x = page.skyline[i].x;
+			y = top;
+		}
+	}
+
+	if (bestIndex < 0)
+		return false;
+
+	page.skyline.insert(page.skyline.begin() + bestIndex, {x, y + height, width});
+
+	// Cut the segments now covered by the new one
+	for (size_t i = bestIndex + 1; i < page.skyline.size();)
+	{
+		auto& current = page.skyline[i];
+		const auto& previous = page.skyline[i - 1];
+		int previousEnd = previous.x + previous.width;
+
+		if (current.x >= previousEnd)
+			break;
+
+		int shrink = previousEnd - current.x;
+		current.x += shrink;
+		current.width -= shrink;
+
+		if (current.width > 0)
+			break;
+
+		page.skyline.erase(page.skyline.begin() + i);
+	}
+
+	// Merge neighbours that ended up at the same height
+	for (size_t i = 0; i + 1 < page.skyline.size();)
+	{
+		if (page.skyline[i].y == page.skyline[i + 1].y)
+		{
+			page.skyline[i].width += page.skyline[i + 1].width;
+			page.skyline.erase(page.skyline.begin() + i + 1);
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	return true;
+}
+
+cocos2d::SpriteFrame* DynamicAtlas::CreateSpriteFrame(const std::string& filepath, const cocos2d::Rect& rect, bool rotated, const cocos2d::Vec2& offset, const cocos2d::Size& originalSize)
+{
+	auto image = new (std::nothrow) cocos2d::Image();
+	if (!image || !image->initWithImageFile(filepath))
+	{
+		CC_SAFE_RELEASE(image);
+		return nullptr;
+	}
+
+	cocos2d::SpriteFrame* sf = this->CreateSpriteFrame(image, rect, rotated, offset, originalSize);
+	image->release();
+
+	return sf;
+}
+
+cocos2d::SpriteFrame* DynamicAtlas::CreateSpriteFrame(cocos2d::Image* image, const cocos2d::Rect& rect, bool rotated, const cocos2d::Vec2& offset, const cocos2d::Size& originalSize)
+{
+	const float contentScale = CC_CONTENT_SCALE_FACTOR();
+
+	// Region of the source image covered by the frame, in pixels. Rotated frames are stored sideways in the texture.
+	float left = rect.origin.x * contentScale;
+	float top = rect.origin.y * contentScale;
+	float right = left + (rotated ? rect.size.height : rect.size.width) * contentScale;
+	float bottom = top + (rotated ? rect.size.width : rect.size.height) * contentScale;
+
+	int srcX = static_cast<int>(std::floor(left));
+	int srcY = static_cast<int>(std::floor(top));
+	int srcW = static_cast<int>(std::ceil(right)) - srcX;
+	int srcH = static_cast<int>(std::ceil(bottom)) - srcY;
+
+	if (srcW <= 0 || srcH <= 0 || srcW > m_MaxSpriteSize || srcH > m_MaxSpriteSize)
+		return nullptr;
+
+	int packedW = srcW + 2 * kBorder;
+	int packedH = srcH + 2 * kBorder;
+	if (packedW > m_PageSize || packedH > m_PageSize)
+		return nullptr;
+
+	// Only uncompressed RGBA images can be copied into a page as-is
+	int imageW = image->getWidth();
+	int imageH = image->getHeight();
+	if (image->isCompressed() || image->getRenderFormat() != cocos2d::Texture2D::PixelFormat::RGBA8888 ||
+		srcX < 0 || srcY < 0 || srcX + srcW > imageW || srcY + srcH > imageH)
+	{
+		return nullptr;
+	}
+
+	bool premultipliedAlpha = image->hasPremultipliedAlpha();
+
+	Page* page = nullptr;
+	int x = 0;
+	int y = 0;
+	for (auto& candidate : m_Pages)
+	{
+		if (candidate.premultipliedAlpha == premultipliedAlpha && this->Insert(candidate, packedW, packedH, x, y))
+		{
+			page = &candidate;
+			break;
+		}
+	}
+
+	if (!page)
+	{
+		page = this->CreatePage(premultipliedAlpha);
+		if (!page || !this->Insert(*page, packedW, packedH, x, y))
+		{
+			return nullptr;
+		}
+	}
+
+	// Copy the region, extruding its edge pixels into the border
+	std::vector<unsigned char> pixels(static_cast<size_t>(packedW) * packedH * kBytesPerPixel);
+	const unsigned char* src = image->getData();
+	for (int row = 0; row < packedH; ++row)
+	{
+		int srcRow = srcY + std::min(std::max(row - kBorder, 0), srcH - 1);
+		const unsigned char* srcLine = src + (static_cast<size_t>(srcRow) * imageW + srcX) * kBytesPerPixel;
+		unsigned char* dstLine = pixels.data() + static_cast<size_t>(row) * packedW * kBytesPerPixel;
+
+		std::memcpy(dstLine + kBorder * kBytesPerPixel, srcLine, static_cast<size_t>(srcW) * kBytesPerPixel);
+		for (int i = 0; i < kBorder; ++i)
+		{
+			std::memcpy(dstLine + i * kBytesPerPixel, srcLine, kBytesPerPixel);
+			std::memcpy(dstLine + (kBorder + srcW + i) * kBytesPerPixel, srcLine + (srcW - 1) * kBytesPerPixel, kBytesPerPixel);
+		}
+	}
+
+	page->texture->updateWithData(pixels.data(), x, y, packedW, packedH);
+
+#if CC_ENABLE_CACHE_TEXTURE_DATA
+	for (int row = 0; row < packedH; ++row)
+	{
+		std::memcpy(page->pixels.data() + (static_cast<size_t>(y + row) * m_PageSize + x) * kBytesPerPixel,
+			pixels.data() + static_cast<size_t>(row) * packedW * kBytesPerPixel,
+			static_cast<size_t>(packedW) * kBytesPerPixel);
+	}
+#endif
+
+	// Keep the sub-pixel part of the original rect so scaled (split quality) frames sample the same texels
+	cocos2d::Rect packedRect((x + kBorder + (left - srcX)) / contentScale,
+		(y + kBorder + (top - srcY)) / contentScale,
+		rect.size.width,
+		rect.size.height);
+
+	return cocos2d::SpriteFrame::createWithTexture(page->texture, packedRect, rotated, offset, originalSize);
+}
+
+NS_CCR_END
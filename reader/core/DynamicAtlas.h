@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "cocos2d.h"
+
+#include "../Macros.h"
+
+NS_CCR_BEGIN
+
+// Packs standalone (non-atlas) sprite images into shared texture pages at runtime,
+// so that sprites which would otherwise each use their own texture can be batched together.
+// Pages are filled using a skyline bottom-left packer and grow one page at a time.
+class DynamicAtlas
+{
+private:
+	struct SkylineNode
+	{
+		int x;
+		int y;
+		int width;
+	};
+
+	struct Page
+	{
+		cocos2d::Texture2D* texture;
+		bool premultipliedAlpha;
+		std::vector<SkylineNode> skyline;
+#if CC_ENABLE_CACHE_TEXTURE_DATA
+		// Copy of the page's pixels, uploaded again when the GL context is lost and recreated
+		std::vector<unsigned char> pixels;
+#endif
+	};
+
+	std::vector<Page> m_Pages;
+
+#if CC_ENABLE_CACHE_TEXTURE_DATA
+	// Restores the pages on EVENT_RENDERER_RECREATED. The texture cache only reloads them as they were created, blank.
+	cocos2d::EventListenerCustom* m_RecreatedListener;
+#endif
+
+	// Width and height of each page in pixels
+	int m_PageSize;
+
+	// Images whose width or height (in pixels) exceed this are left in their own texture
+	int m_MaxSpriteSize;
+
+	Page* CreatePage(bool premultipliedAlpha);
+	bool Insert(Page& page, int width, int height, int& x, int& y);
+	int Fits(const Page& page, size_t index, int width, int height) const;
+
+public:
+	DynamicAtlas();
+	~DynamicAtlas();
+
+	inline void SetPageSize(int value) { m_PageSize = value; }
+	inline int GetPageSize() const { return m_PageSize; }
+	inline void SetMaxSpriteSize(int value) { m_MaxSpriteSize = value; }
+	inline int GetMaxSpriteSize() const { return m_MaxSpriteSize; }
+	inline size_t GetPageCount() const { return m_Pages.size(); }
+
+	/**
+	 Copies the region `rect` (in pixels) of the image `filepath` into an atlas page and creates a spriteframe pointing into it.
+	 Must be called on the cocos thread, as it uploads to the page texture.
+	 @return The packed spriteframe, or nullptr if the image is too big, has an unsupported format or no page has room for it
+	 */
+	cocos2d::SpriteFrame* CreateSpriteFrame(const std::string& filepath, const cocos2d::Rect& rect, bool rotated, const cocos2d::Vec2& offset, const cocos2d::Size& originalSize);
+
+	// Same as above, from an already decoded image
+	cocos2d::SpriteFrame* CreateSpriteFrame(cocos2d::Image* image, const cocos2d::Rect& rect, bool rotated, const cocos2d::Vec2& offset, const cocos2d::Size& originalSize);
+
+	// Releases all pages, sprites packed afterwards go into new ones. Spriteframes already created keep their page
+	// texture alive, but on platforms that lose the GL context it is not restored any more.
+	void Clear();
+
+	CREATOR_DISALLOW_COPY_ASSIGN_AND_MOVE(DynamicAtlas);
+};
+
+NS_CCR_END
@@ -0,0 +1,260 @@
+#include "NodeDecoder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <thread>
+
+NS_CCR_BEGIN
+
+namespace
+{
+// Subtrees smaller than this are decoded as a whole by a single thread
+const uint32_t kMinSubtreeSizePerJob = 32;
+
+struct DecodeJob
+{
+	const buffers::NodeTree* tree;
+	uint32_t index;
+};
+
+uint32_t CountEntries(const buffers::NodeTree* tree, std::vector<uint32_t>& sizes)
+{
+	const uint32_t index = static_cast<uint32_t>(sizes.size());
+	sizes.push_back(1);
+
+	uint32_t size = 1;
+	const auto& children = tree->children();
+	if (children)
+	{
+		for (const auto& child : *children)
+		{
+			size += CountEntries(child, sizes);
+		}
+	}
+
+	sizes[index] = size;
+	return size;
+}
+
+void DecodeEntry(const buffers::NodeTree* tree, NodeDescriptor& descriptor)
+{
+	const buffers::Node* nodeBuffer = NodeDecoder::GetNodeBuffer(tree);
+	if (nodeBuffer)
+		NodeDecoder::DecodeNode(nodeBuffer, descriptor);
+
+	switch (tree->object_type())
+	{
+	case buffers::AnyNode_Label: {
+		const auto labelBuffer = tree->object_as_Label();
+		if (labelBuffer->labelText())
+			descriptor.labelText = labelBuffer->labelText()->str();
+		if (labelBuffer->fontName())
+			descriptor.fontName = labelBuffer->fontName()->str();
+	}
+	break;
+	default:
+		break;
+	}
+}
+
+void DecodeSubtree(const buffers::NodeTree* tree, uint32_t index, NodeDescriptor* descriptors)
+{
+	DecodeEntry(tree, descriptors[index]);
+
+	uint32_t childIndex = index + 1;
+	const auto& children = tree->children();
+	if (children)
+	{
+		for (const auto& child : *children)
+		{
+			DecodeSubtree(child, childIndex, descriptors);
+			childIndex += descriptors[childIndex].subtreeSize;
+		}
+	}
+}
+
+// Decodes the entries above `grain` on the calling thread and collects the subtrees below it as jobs
+void Split(const buffers::NodeTree* tree, uint32_t index, uint32_t grain, NodeDescriptor* descriptors, std::vector<DecodeJob>& jobs)
+{
+	if (descriptors[index].subtreeSize <= grain)
+	{
+		jobs.push_back({tree, index});
+		return;
+	}
+
+	DecodeEntry(tree, descriptors[index]);
+
+	uint32_t childIndex = index + 1;
+	const auto& children = tree->children();
+	if (children)
+	{
+		for (const auto& child : *children)
+		{
+			Split(child, childIndex, grain, descriptors, jobs);
+			childIndex += descriptors[childIndex].subtreeSize;
+		}
+	}
+}
+} // namespace
+
+namespace NodeDecoder
+{
+void DecodeNode(const buffers::Node* nodeBuffer, NodeDescriptor& descriptor)
+{
+	descriptor.source = nodeBuffer;
+
+	const auto& name = nodeBuffer->name();
+	descriptor.hasName = name != nullptr;
+	if (name)
+		descriptor.name = name->str();
+
+	const auto& anchorPoint = nodeBuffer->anchorPoint();
+	descriptor.hasAnchorPoint = anchorPoint != nullptr;
+	if (anchorPoint)
+		descriptor.anchorPoint = cocos2d::Vec2(anchorPoint->x(), anchorPoint->y());
+
+	const auto& color = nodeBuffer->color();
+	descriptor.hasColor = color != nullptr;
+	if (color)
+		descriptor.color = cocos2d::Color3B(color->r(), color->g(), color->b());
+
+	const auto& position = nodeBuffer->position();
+	descriptor.hasPosition = position != nullptr;
+	if (position)
+		descriptor.position = cocos2d::Vec2(position->x(), position->y());
+
+	const auto& contentSize = nodeBuffer->contentSize();
+	descriptor.hasContentSize = contentSize != nullptr;
+	if (contentSize)
+		descriptor.contentSize = cocos2d::Size(contentSize->w(), contentSize->h());
+
+	descriptor.globalZOrder = nodeBuffer->globalZOrder();
+	descriptor.localZOrder = nodeBuffer->localZOrder();
+	descriptor.opacity = nodeBuffer->opacity();
+	descriptor.cascadeOpacityEnabled = nodeBuffer->cascadeOpacityEnabled();
+	descriptor.opacityModifyRGB = nodeBuffer->opacityModifyRGB();
+	descriptor.rotationSkewX = nodeBuffer->rotationSkewX();
+	descriptor.rotationSkewY = nodeBuffer->rotationSkewY();
+	descriptor.scaleX = nodeBuffer->scaleX();
+	descriptor.scaleY = nodeBuffer->scaleY();
+	descriptor.skewX = nodeBuffer->skewX();
+	descriptor.skewY = nodeBuffer->skewY();
+	descriptor.tag = nodeBuffer->tag();
+	descriptor.visible = nodeBuffer->enabled();
+}
+
+const buffers::Node* GetNodeBuffer(const buffers::NodeTree* tree)
+{
+	const void* buffer = tree->object();
+	if (!buffer)
+		return nullptr;
+
+	switch (tree->object_type())
+	{
+	case buffers::AnyNode_Node:
+		return static_cast<const buffers::Node*>(buffer);
+	case buffers::AnyNode_Sprite:
+		return static_cast<const buffers::Sprite*>(buffer)->node();
+	case buffers::AnyNode_Label:
+		return static_cast<const buffers::Label*>(buffer)->node();
+	case buffers::AnyNode_Particle:
+		return static_cast<const buffers::Particle*>(buffer)->node();
+	case buffers::AnyNode_TileMap:
+		return static_cast<const buffers::TileMap*>(buffer)->node();
+	case buffers::AnyNode_Button:
+		return static_cast<const buffers::Button*>(buffer)->node();
+	case buffers::AnyNode_ProgressBar:
+		return static_cast<const buffers::ProgressBar*>(buffer)->node();
+	case buffers::AnyNode_ScrollView:
+		return static_cast<const buffers::ScrollView*>(buffer)->node();
+	case buffers::AnyNode_EditBox:
+		return static_cast<const buffers::EditBox*>(buffer)->node();
+	case buffers::AnyNode_RichText:
+		return static_cast<const buffers::RichText*>(buffer)->node();
+	case buffers::AnyNode_SpineSkeleton:
+		return static_cast<const buffers::SpineSkeleton*>(buffer)->node();
+	case buffers::AnyNode_VideoPlayer:
+		return static_cast<const buffers::VideoPlayer*>(buffer)->node();
+	case buffers::AnyNode_WebView:
+		return static_cast<const buffers::WebView*>(buffer)->node();
+	case buffers::AnyNode_Slider:
+		return static_cast<const buffers::Slider*>(buffer)->node();
+	case buffers::AnyNode_Toggle:
+		return static_cast<const buffers::Toggle*>(buffer)->node();
+	case buffers::AnyNode_ToggleGroup:
+		return static_cast<const buffers::ToggleGroup*>(buffer)->node();
+	case buffers::AnyNode_PageView:
+		return static_cast<const buffers::PageView*>(buffer)->node();
+	case buffers::AnyNode_Mask:
+		return static_cast<const buffers::Mask*>(buffer)->node();
+	case buffers::AnyNode_DragonBones:
+		return static_cast<const buffers::DragonBones*>(buffer)->node();
+	case buffers::AnyNode_MotionStreak:
+		return static_cast<const buffers::MotionStreak*>(buffer)->node();
+	case buffers::AnyNode_Prefab:
+		return static_cast<const buffers::Prefab*>(buffer)->node();
+	case buffers::AnyNode_Layout:
+		return static_cast<const buffers::Layout*>(buffer)->node();
+	default:
+		return nullptr;
+	}
+}
+
+void Decode(const buffers::NodeTree* root, std::vector<NodeDescriptor>& descriptors, unsigned int threadCount)
+{
+	descriptors.clear();
+	if (!root)
+		return;
+
+	// Pre-order positions are known once the subtree sizes are, so every job can fill its own slice of the array
+	std::vector<uint32_t> sizes;
+	CountEntries(root, sizes);
+
+	descriptors.resize(sizes.size());
+	for (size_t i = 0; i < sizes.size(); ++i)
+	{
+		descriptors[i].subtreeSize = sizes[i];
+	}
+
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	const uint32_t total = static_cast<uint32_t>(descriptors.size());
+	if (threadCount == 1 || total <= kMinSubtreeSizePerJob)
+	{
+		DecodeSubtree(root, 0, descriptors.data());
+		return;
+	}
+
+	// Aim for a few jobs per thread so uneven subtrees still balance out
+	const uint32_t grain = std::max(kMinSubtreeSizePerJob, total / (threadCount * 4));
+	std::vector<DecodeJob> jobs;
+	Split(root, 0, grain, descriptors.data(), jobs);
+
+	std::atomic<size_t> nextJob(0);
+	auto worker = [&jobs, &nextJob, &descriptors]() {
+		for (size_t i = nextJob++; i < jobs.size(); i = nextJob++)
+		{
+			DecodeSubtree(jobs[i].tree, jobs[i].index, descriptors.data());
+		}
+	};
+
+	std::vector<std::future<void>> workers;
+	const unsigned int workerCount = std::min<unsigned int>(threadCount, static_cast<unsigned int>(jobs.size())) - 1;
+	for (unsigned int i = 0; i < workerCount; ++i)
+	{
+		workers.push_back(std::async(std::launch::async, worker));
+	}
+
+	// The calling thread takes jobs as well
+	worker();
+
+	for (auto& future : workers)
+	{
+		future.get();
+	}
+}
+} // namespace NodeDecoder
+
+NS_CCR_END
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "cocos2d.h"
+
+#include "../CreatorReader_generated.h"
+#include "../Macros.h"
+
+NS_CCR_BEGIN
+
+// Properties of a single NodeTree entry, read from the FlatBuffer and converted to cocos types ahead of node creation
+struct NodeDescriptor
+{
+	// The node table the values were read from; nullptr for entries that have none (scenes, empty entries)
+	const buffers::Node* source = nullptr;
+
+	// Number of entries in this subtree, including this one
+	uint32_t subtreeSize = 1;
+
+	std::string name;
+	cocos2d::Vec2 position;
+	cocos2d::Vec2 anchorPoint;
+	cocos2d::Size contentSize;
+	cocos2d::Color3B color;
+	float rotationSkewX = 0;
+	float rotationSkewY = 0;
+	float scaleX = 1;
+	float scaleY = 1;
+	float skewX = 0;
+	float skewY = 0;
+	float globalZOrder = 0;
+	int localZOrder = 0;
+	int tag = 0;
+	GLubyte opacity = 255;
+	bool hasName = false;
+	bool hasPosition = false;
+	bool hasAnchorPoint = false;
+	bool hasContentSize = false;
+	bool hasColor = false;
+	bool cascadeOpacityEnabled = false;
+	bool opacityModifyRGB = false;
+	bool visible = true;
+
+	// Labels
+	std::string labelText;
+	std::string fontName;
+};
+
+/**
+ Decode stage of node creation. Walks a NodeTree and produces one `NodeDescriptor` per entry, in the
+ same pre-order `Reader::createTree` visits them, so the cocos thread only has to consume the array.
+ Subtrees are decoded on worker threads. Spriteframes are not part of it: the cache may drop or replace them
+ before the nodes are created (quality switches, removeUnusedSpriteFrames), they are looked up by name then.
+ */
+namespace NodeDecoder
+{
+// Reads the properties of a node table, the ones every node type has
+void DecodeNode(const buffers::Node* nodeBuffer, NodeDescriptor& descriptor);
+
+// Returns the node table of a tree entry, or nullptr if the entry type has none
+const buffers::Node* GetNodeBuffer(const buffers::NodeTree* tree);
+
+// `threadCount` of 0 uses the number of hardware threads
+void Decode(const buffers::NodeTree* root, std::vector<NodeDescriptor>& descriptors, unsigned int threadCount = 0);
+} // namespace NodeDecoder
+
+NS_CCR_END
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <array>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "../Macros.h"
+
+NS_CCR_BEGIN
+
+// String keyed map that can be read and written from several threads at once.
+// Keys are spread over `ShardCount` independently locked maps, so threads only contend when they hit the same shard.
+template <typename T, size_t ShardCount = 16>
+class ShardedMap
+{
+private:
+	struct Shard
+	{
+		mutable std::mutex mutex;
+		std::unordered_map<std::string, T> map;
+	};
+
+	std::array<Shard, ShardCount> m_Shards;
+
+	inline Shard& GetShard(const std::string& key) { return m_Shards[std::hash<std::string>()(key) % ShardCount]; }
+	inline const Shard& GetShard(const std::string& key) const { return m_Shards[std::hash<std::string>()(key) % ShardCount]; }
+
+public:
+	ShardedMap() = default;
+
+	// Inserts the value unless the key is already present
+	// @return true if the value was inserted
+	bool Emplace(const std::string& key, const T& value)
+	{
+		Shard& shard = this->GetShard(key);
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		return shard.map.emplace(key, value).second;
+	}
+
+	// Inserts or replaces the value
+	void Set(const std::string& key, const T& value)
+	{
+		Shard& shard = this->GetShard(key);
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		shard.map[key] = value;
+	}
+
+	// @return true if the key is present, `value` then holds a copy of its value
+	bool Find(const std::string& key, T& value) const
+	{
+		const Shard& shard = this->GetShard(key);
+		std::lock_guard<std::mutex> lock(shard.mutex);
+
+		auto it = shard.map.find(key);
+		if (it == shard.map.end())
+			return false;
+
+		value = it->second;
+		return true;
+	}
+
+	bool Contains(const std::string& key) const
+	{
+		const Shard& shard = this->GetShard(key);
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		return shard.map.count(key) > 0;
+	}
+
+	// Calls `function(key, value)` for every entry, holding one shard lock at a time
+	void ForEach(const std::function<void(const std::string&, const T&)>& function) const
+	{
+		for (const auto& shard : m_Shards)
+		{
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			for (const auto& pair : shard.map)
+			{
+				function(pair.first, pair.second);
+			}
+		}
+	}
+
+	// @return true if `predicate(value)` holds for any value
+	bool AnyOf(const std::function<bool(const T&)>& predicate) const
+	{
+		for (const auto& shard : m_Shards)
+		{
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			for (const auto& pair : shard.map)
+			{
+				if (predicate(pair.second))
+					return true;
+			}
+		}
+
+		return false;
+	}
+
+	// Copies all entries into a single map. Entries written concurrently may or may not be part of it.
+	std::unordered_map<std::string, T> Snapshot() const
+	{
+		std::unordered_map<std::string, T> snapshot;
+		this->ForEach([&snapshot](const std::string& key, const T& value) {
+			snapshot.emplace(key, value);
+		});
+
+		return snapshot;
+	}
+
+	size_t Size() const
+	{
+		size_t size = 0;
+		for (const auto& shard : m_Shards)
+		{
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			size += shard.map.size();
+		}
+
+		return size;
+	}
+
+	void Clear()
+	{
+		for (auto& shard : m_Shards)
+		{
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			shard.map.clear();
+		}
+	}
+
+	CREATOR_DISALLOW_COPY_ASSIGN_AND_MOVE(ShardedMap);
+};
+
+NS_CCR_END
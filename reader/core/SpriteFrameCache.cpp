@@ -1,180 +1,578 @@
 #include "SpriteFrameCache.h"
 
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include <unordered_set>
+
 #include "../CreatorReader.h"
 
 NS_CCR_BEGIN
 
+namespace
+{
+cocos2d::Image* DecodeImage(const std::string& filepath, std::unordered_map<std::string, cocos2d::Image*>& images)
+{
+	auto it = images.find(filepath);
+	if (it != images.end())
+		return it->second;
+
+	auto image = new (std::nothrow) cocos2d::Image();
+	if (image && !image->initWithImageFile(filepath))
+	{
+		image->release();
+		image = nullptr;
+	}
+
+	images.emplace(filepath, image);
+	return image;
+}
+} // namespace
+
 SpriteFrameCache* SpriteFrameCache::instance = nullptr;
 
-SpriteFrameCache::SpriteFrameCache()
+SpriteFrameCache::SpriteFrameCache() :
+	m_QualitySwitchGeneration(0),
+	m_PublishScheduled(false),
+	m_LifetimeToken(std::make_shared<char>())
 {
 	SpriteFrameCache::instance = this;
 }
 
 SpriteFrameCache::~SpriteFrameCache()
 {
+	for (auto& frame : m_PendingSpriteFrames)
+	{
+		CC_SAFE_RELEASE(frame.spriteFrame);
+		CC_SAFE_RELEASE(frame.image);
+	}
+
 	SpriteFrameCache::instance = nullptr;
 }
 
 void SpriteFrameCache::AddSpriteFrames(const void* buffer)
 {
-	buffer = buffer ? buffer : Reader::i()->_data.getBytes();
+	this->AddSpriteFrames(buffer ? buffer : Reader::i()->m_Context->data.getBytes(), Reader::i()->GetSpriteFrameSettings());
+}
+
+void SpriteFrameCache::AddSpriteFrames(const void* buffer, const SpriteFrameSettings& settings)
+{
 	const auto& sceneGraph = buffers::GetNodeGraph(buffer);
 	const auto& spriteFrames = sceneGraph->spriteFrames();
-	auto frameCache = cocos2d::SpriteFrameCache::getInstance();
-    float scale = Reader::i()->m_SpriteRectScale;
+	const float scale = settings.rectScale;
+
+	if (!spriteFrames)
+		return;
+
+	const bool onCocosThread = std::this_thread::get_id() == cocos2d::Director::getInstance()->getCocos2dThreadId();
+
+	std::vector<PendingSpriteFrame> frames;
+	frames.reserve(spriteFrames->size());
+
+	// Images decoded for this batch by path, frames of the same file share one
+	std::unordered_map<std::string, cocos2d::Image*> images;
 
-	if (spriteFrames)
+	for (const auto& spriteFrame : *spriteFrames)
 	{
-		for (const auto& spriteFrame : *spriteFrames)
+		const auto& centerRect = spriteFrame->centerRect();
+
+		PendingSpriteFrame frame;
+		frame.name = spriteFrame->name()->str();
+
+		// Assumption: The atlas has already been loaded into the spriteframe cache
+		if (spriteFrame->atlas())
+		{
+			frame.type = FrameType::Atlas;
+			frame.centerRect = cocos2d::Rect(centerRect->x() * scale, centerRect->y() * scale, centerRect->w() * scale, centerRect->h() * scale);
+			frames.push_back(std::move(frame));
+			continue;
+		}
+
+		// Spriteframe already loaded
+		if (this->IsRegistered(frame.name))
+			continue;
+
+		std::string filepath = spriteFrame->texturePath()->str();
+		const auto& rect = spriteFrame->rect();
+		const auto& offset = spriteFrame->offset();
+		const auto& originalSize = spriteFrame->originalSize();
+
+		frame.rotated = spriteFrame->rotated();
+		frame.offset = cocos2d::Vec2(offset->x(), offset->y());
+
+		// Find the actual file name
+		std::string filename = filepath;
+		const std::string creatorSpritePath = "creator/resources/sprites/";
+		if (filename.find(creatorSpritePath) != std::string::npos)
 		{
-			// Assumption: The atlas has already been loaded into the spriteframe cache
-			if (spriteFrame->atlas())
+			filename = filename.replace(filename.begin(), filename.begin() + creatorSpritePath.length(), "");
+		}
+
+		// If the file is inside the "split_qualities" folder, the file path will be prefixed with m_SpriteBasePath
+		std::string search = "split_qualities/";
+		size_t position = filename.find(search);
+		if (position != std::string::npos)
+		{
+			// size_t start_pos = name.find("split_qualities/");
+			// name.replace(start_pos, name.length(), "");
+
+			// Erase this as we do not need it anymore
+			filename.erase(position, search.length());
+			filepath = GetSplitTexturePath(filename, settings.basePath, settings.pathReplacements);
+
+			frame.type = FrameType::Split;
+			frame.rect = cocos2d::Rect(rect->x() * scale, rect->y() * scale, rect->w() * scale, rect->h() * scale);
+			frame.originalSize = cocos2d::Size(originalSize->w() * scale, originalSize->h() * scale);
+			frame.centerRect = cocos2d::Rect(centerRect->x() * scale, centerRect->y() * scale, centerRect->w() * scale, centerRect->h() * scale);
+
+			// Remember the unscaled values, so the frame can be moved to another quality tier later
+			frame.source.filename = filename;
+			frame.source.rect = cocos2d::Rect(rect->x(), rect->y(), rect->w(), rect->h());
+			frame.source.originalSize = cocos2d::Size(originalSize->w(), originalSize->h());
+			frame.source.centerRect = cocos2d::Rect(centerRect->x(), centerRect->y(), centerRect->w(), centerRect->h());
+		}
+		// No split needed
+		else
+		{
+			// Erase no_split (if present)
+			search = "no_split/";
+			position = filename.find(search);
+
+			if (position != std::string::npos)
 			{
-				cocos2d::SpriteFrame* sf = frameCache->getSpriteFrameByName(spriteFrame->name()->str());
-				if (sf)
-				{
-					const auto& centerRect = spriteFrame->centerRect();
-					sf->setCenterRectInPixels(cocos2d::Rect(centerRect->x() * scale, centerRect->y() * scale, centerRect->w() * scale, centerRect->h() * scale));
-					m_AtlasSpriteFrames.emplace(spriteFrame->name()->str(), sf);
-				}
-				else
+				// size_t start_pos = name.find("no_split/");
+				// name.replace(start_pos, name.length(), "");
+				filename.erase(position, search.length());
+			}
+
+			filepath = std::string("sprites/").append(filename);
+			std::string dirname = filepath.substr(0, filepath.find_last_of("/\\")).append("/");
+			for (const auto& path: settings.pathReplacements)
+			{
+				if (dirname.rfind(path.first, 0) == 0)
 				{
-					CCLOG("Failed to find spriteframe %s in any atlas. Did you forget to load the atlas that contains this spriteframe?", spriteFrame->name()->c_str());
+					filepath.replace(0, path.first.length(), path.second);
 				}
 			}
+			
+			if (!cocos2d::FileUtils::getInstance()->isFileExist(filepath))
+			{
+				// Fallback to creator path
+				filepath = creatorSpritePath + filename;
+			}
+
+			frame.type = FrameType::NoSplit;
+			frame.rect = cocos2d::Rect(rect->x(), rect->y(), rect->w(), rect->h());
+			frame.originalSize = cocos2d::Size(originalSize->w(), originalSize->h());
+			frame.centerRect = cocos2d::Rect(centerRect->x(), centerRect->y(), centerRect->w(), centerRect->h());
+		}
+
+		frame.filepath = filepath;
+
+		// Decode now, so publishing only has to upload the texture
+		if (!onCocosThread)
+		{
+			frame.image = DecodeImage(filepath, images);
+			CC_SAFE_RETAIN(frame.image);
+		}
+
+		frames.push_back(std::move(frame));
+	}
+
+	for (auto& pair : images)
+	{
+		CC_SAFE_RELEASE(pair.second);
+	}
+
+	if (onCocosThread)
+		this->Publish(frames);
+	else
+		this->Enqueue(frames);
+}
+
+void SpriteFrameCache::PublishPendingSpriteFrames()
+{
+	std::vector<PendingSpriteFrame> frames;
+	{
+		std::lock_guard<std::mutex> lock(m_PendingMutex);
+		frames.swap(m_PendingSpriteFrames);
+		m_PublishScheduled = false;
+	}
+
+	this->Publish(frames);
+}
+
+void SpriteFrameCache::Enqueue(std::vector<PendingSpriteFrame>& frames)
+{
+	bool schedule = false;
+	{
+		std::lock_guard<std::mutex> lock(m_PendingMutex);
+		std::move(frames.begin(), frames.end(), std::back_inserter(m_PendingSpriteFrames));
+
+		// A single publication serves every batch queued until it runs
+		schedule = !m_PublishScheduled;
+		m_PublishScheduled = true;
+	}
+
+	frames.clear();
+
+	if (schedule)
+	{
+		std::weak_ptr<char> alive = m_LifetimeToken;
+		cocos2d::Director::getInstance()->getScheduler()->performFunctionInCocosThread([this, alive]() {
+			if (!alive.expired())
+				this->PublishPendingSpriteFrames();
+		});
+	}
+}
+
+void SpriteFrameCache::Publish(std::vector<PendingSpriteFrame>& frames)
+{
+	auto frameCache = cocos2d::SpriteFrameCache::getInstance();
+
+	for (auto& frame : frames)
+	{
+		// Registered through AddTo*, only the cocos cache is missing it
+		if (frame.spriteFrame)
+		{
+			frameCache->addSpriteFrame(frame.spriteFrame, frame.name);
+			frame.spriteFrame->release();
+			continue;
+		}
+
+		if (frame.type == FrameType::Atlas)
+		{
+			cocos2d::SpriteFrame* sf = frameCache->getSpriteFrameByName(frame.name);
+			if (sf)
+			{
+				sf->setCenterRectInPixels(frame.centerRect);
+				m_AtlasSpriteFrames.Emplace(frame.name, sf);
+			}
 			else
 			{
-				std::string name = spriteFrame->name()->str();
-				cocos2d::SpriteFrame* sf = frameCache->getSpriteFrameByName(name);
-
-				// Spriteframe already loaded
-				if (sf)
-					continue;
-
-				std::string filepath = spriteFrame->texturePath()->str();
-				const auto& rect = spriteFrame->rect();
-				const auto& rotated = spriteFrame->rotated();
-				const auto& offset = spriteFrame->offset();
-				const auto& originalSize = spriteFrame->originalSize();
-
-				// Find the actual file name
-				std::string filename = filepath;
-				const std::string creatorSpritePath = "creator/resources/sprites/";
-				if (filename.find(creatorSpritePath) != std::string::npos)
-				{
-					filename = filename.replace(filename.begin(), filename.begin() + creatorSpritePath.length(), "");
-				}
+				CCLOG("Failed to find spriteframe %s in any atlas. Did you forget to load the atlas that contains this spriteframe?", frame.name.c_str());
+			}
 
-				// If the file is inside the "split_qualities" folder, the file path will be prefixed with m_SpriteBasePath
-				std::string search = "split_qualities/";
-				size_t position = filename.find(search);
-				if (position != std::string::npos)
-				{
-					// size_t start_pos = name.find("split_qualities/");
-					// name.replace(start_pos, name.length(), "");
-
-					// Erase this as we do not need it anymore
-					filename.erase(position, search.length());
-					filepath = std::string("sprites/").append(Reader::i()->m_SpriteBasePath).append("/").append(filename);
-
-					std::string dirname = filepath.substr(0, filepath.find_last_of("/\\")).append("/");
-					for (const auto& path: Reader::i()->m_PathReplacements)
-					{
-						if (dirname.rfind(path.first, 0) == 0)
-						{
-							filepath.replace(0, path.first.length(), path.second);
-						}
-					}
-
-					sf = cocos2d::SpriteFrame::create(filepath,
-						cocos2d::Rect(rect->x() * scale, rect->y() * scale, rect->w() * scale, rect->h() * scale),
-						rotated,
-						cocos2d::Vec2(offset->x(), offset->y()),
-						cocos2d::Size(originalSize->w() * scale, originalSize->h() * scale));
-
-					if (sf)
-					{
-						const auto& centerRect = spriteFrame->centerRect();
-						sf->setCenterRectInPixels(cocos2d::Rect(centerRect->x() * scale, centerRect->y() * scale, centerRect->w() * scale, centerRect->h() * scale));
-						m_SplitSpriteFrames.emplace(name, sf);
-					}
-				}
-				// No split needed
-				else
-				{
-					// Erase no_split (if present)
-					search = "no_split/";
-					position = filename.find(search);
-
-					if (position != std::string::npos)
-					{
-						// size_t start_pos = name.find("no_split/");
-						// name.replace(start_pos, name.length(), "");
-						filename.erase(position, search.length());
-					}
-
-					filepath = std::string("sprites/").append(filename);
-					std::string dirname = filepath.substr(0, filepath.find_last_of("/\\")).append("/");
-					for (const auto& path: Reader::i()->m_PathReplacements)
-					{
-						if (dirname.rfind(path.first, 0) == 0)
-						{
-							filepath.replace(0, path.first.length(), path.second);
-						}
-					}
-					
-					if (!cocos2d::FileUtils::getInstance()->isFileExist(filepath))
-					{
-						// Fallback to creator path
-						filepath = creatorSpritePath + filename;
-					}
-
-					sf = cocos2d::SpriteFrame::create(filepath,
-						cocos2d::Rect(rect->x(), rect->y(), rect->w(), rect->h()),
-						rotated,
-						cocos2d::Vec2(offset->x(), offset->y()),
-						cocos2d::Size(originalSize->w(), originalSize->h()));
-
-					if (sf)
-					{
-						const auto& centerRect = spriteFrame->centerRect();
-						sf->setCenterRectInPixels(cocos2d::Rect(centerRect->x(), centerRect->y(), centerRect->w(), centerRect->h()));
-						m_NoSplitSpriteFrames.emplace(name, sf);
-					}
-				}
+			continue;
+		}
+
+		// Spriteframe already loaded, possibly by another batch of the same file
+		if (frameCache->getSpriteFrameByName(frame.name))
+		{
+			CC_SAFE_RELEASE(frame.image);
+			continue;
+		}
+
+		cocos2d::SpriteFrame* sf = this->CreateStandaloneSpriteFrame(frame.filepath, frame.image, frame.rect, frame.rotated, frame.offset, frame.originalSize);
+		CC_SAFE_RELEASE(frame.image);
+
+		if (!sf)
+			continue;
 
-				if (sf)
+		sf->setCenterRectInPixels(frame.centerRect);
+		if (frame.type == FrameType::Split)
+		{
+			m_SplitSpriteFrames.Emplace(frame.name, sf);
+			m_SplitSpriteFrameSources[frame.name] = frame.source;
+		}
+		else
+		{
+			m_NoSplitSpriteFrames.Emplace(frame.name, sf);
+		}
+
+		frameCache->addSpriteFrame(sf, frame.name);
+	}
+
+	frames.clear();
+}
+
+void SpriteFrameCache::RemoveSpriteFrames()
+{
+	auto frameCache = cocos2d::SpriteFrameCache::getInstance();
+	auto removeFrame = [frameCache](const std::string& name, cocos2d::SpriteFrame* const&) {
+		frameCache->removeSpriteFrameByName(name);
+	};
+
+	m_SplitSpriteFrames.ForEach(removeFrame);
+	m_NoSplitSpriteFrames.ForEach(removeFrame);
+	m_AtlasSpriteFrames.ForEach(removeFrame);
+
+	m_SplitSpriteFrames.Clear();
+	m_NoSplitSpriteFrames.Clear();
+	m_AtlasSpriteFrames.Clear();
+	m_SplitSpriteFrameSources.clear();
+
+	m_DynamicAtlas.Clear();
+}
+
+bool SpriteFrameCache::IsRegistered(const std::string& name) const
+{
+	return m_SplitSpriteFrames.Contains(name) || m_NoSplitSpriteFrames.Contains(name) || m_AtlasSpriteFrames.Contains(name);
+}
+
+cocos2d::SpriteFrame* SpriteFrameCache::GetSpriteFrame(const std::string& name) const
+{
+	cocos2d::SpriteFrame* sf = nullptr;
+	if (m_SplitSpriteFrames.Find(name, sf) || m_NoSplitSpriteFrames.Find(name, sf) || m_AtlasSpriteFrames.Find(name, sf))
+		return sf;
+
+	return nullptr;
+}
+
+std::string SpriteFrameCache::GetSplitTexturePath(const std::string& filename, const std::string& basePath, const std::unordered_map<std::string, std::string>& pathReplacements)
+{
+	std::string filepath = std::string("sprites/").append(basePath).append("/").append(filename);
+
+	std::string dirname = filepath.substr(0, filepath.find_last_of("/\\")).append("/");
+	for (const auto& path: pathReplacements)
+	{
+		if (dirname.rfind(path.first, 0) == 0)
+		{
+			filepath.replace(0, path.first.length(), path.second);
+		}
+	}
+
+	return filepath;
+}
+
+cocos2d::SpriteFrame* SpriteFrameCache::CreateStandaloneSpriteFrame(const std::string& filepath, cocos2d::Image* image, const cocos2d::Rect& rect, bool rotated, const cocos2d::Vec2& offset, const cocos2d::Size& originalSize)
+{
+	// Only called while publishing, on the cocos thread; `image` is set if the frame was registered off it
+	if (Reader::i()->m_DynamicAtlasEnabled)
+	{
+		cocos2d::SpriteFrame* sf = image ? m_DynamicAtlas.CreateSpriteFrame(image, rect, rotated, offset, originalSize) : m_DynamicAtlas.CreateSpriteFrame(filepath, rect, rotated, offset, originalSize);
+		if (sf)
+			return sf;
+	}
+
+	if (image)
+	{
+		// Same key addImage(filepath) uses, so the texture is shared with frames loaded on the cocos thread
+		auto textureCache = cocos2d::Director::getInstance()->getTextureCache();
+		const std::string key = cocos2d::FileUtils::getInstance()->fullPathForFilename(filepath);
+
+		cocos2d::Texture2D* texture = textureCache->getTextureForKey(key);
+		if (!texture)
+			texture = textureCache->addImage(image, key);
+
+		return texture ? cocos2d::SpriteFrame::createWithTexture(texture, rect, rotated, offset, originalSize) : nullptr;
+	}
+
+	return cocos2d::SpriteFrame::create(filepath, rect, rotated, offset, originalSize);
+}
+
+void SpriteFrameCache::SwitchSplitQuality(float scale, const std::string& basePath, const std::function<void(bool)>& callback)
+{
+	// A newer switch supersedes any switch whose textures are still loading
+	const unsigned int generation = ++m_QualitySwitchGeneration;
+
+	auto texturePaths = std::make_shared<std::unordered_set<std::string>>(this->GetSplitTexturePaths(basePath));
+	m_QualitySwitchPaths = *texturePaths;
+
+	if (texturePaths->empty())
+	{
+		this->ApplySplitQuality(scale, basePath);
+		if (callback)
+			callback(true);
+		return;
+	}
+
+	// Textures are decoded on the texture cache's loader thread, the callbacks run on the cocos thread
+	auto remaining = std::make_shared<size_t>(texturePaths->size());
+	auto textureCache = cocos2d::Director::getInstance()->getTextureCache();
+	std::weak_ptr<char> alive = m_LifetimeToken;
+	for (const auto& texturePath : *texturePaths)
+	{
+		textureCache->addImageAsync(texturePath, [this, alive, remaining, texturePaths, generation, scale, basePath, callback](cocos2d::Texture2D*) {
+			if (alive.expired() || --(*remaining) > 0)
+				return;
+
+			// Superseded switches are not applied, but their callers are still told. Their textures are dropped,
+			// unless the current tier or the switch that superseded them uses them.
+			if (generation != m_QualitySwitchGeneration)
+			{
+				const auto currentPaths = this->GetSplitTexturePaths(Reader::i()->m_SpriteBasePath);
+				auto cache = cocos2d::Director::getInstance()->getTextureCache();
+				for (const auto& path : *texturePaths)
 				{
-					frameCache->addSpriteFrame(sf, name);
+					if (!currentPaths.count(path) && !m_QualitySwitchPaths.count(path))
+						cache->removeTextureForKey(path);
 				}
+
+				if (callback)
+					callback(false);
+				return;
 			}
+
+			this->ApplySplitQuality(scale, basePath);
+			if (callback)
+				callback(true);
+		});
+	}
+}
+
+std::unordered_set<std::string> SpriteFrameCache::GetSplitTexturePaths(const std::string& basePath) const
+{
+	std::unordered_set<std::string> paths;
+	for (const auto& pair : m_SplitSpriteFrameSources)
+	{
+		paths.insert(GetSplitTexturePath(pair.second.filename, basePath, Reader::i()->m_PathReplacements));
+	}
+
+	return paths;
+}
+
+void SpriteFrameCache::ApplySplitQuality(float scale, const std::string& basePath)
+{
+	const std::string previousBasePath = Reader::i()->m_SpriteBasePath;
+	Reader::i()->m_SpriteRectScale = scale;
+	Reader::i()->m_SpriteBasePath = basePath;
+
+	auto textureCache = cocos2d::Director::getInstance()->getTextureCache();
+	std::unordered_set<cocos2d::SpriteFrame*> switchedFrames;
+
+	// Textures of the previous tier, and those of them still used by frames that could not be switched
+	std::unordered_set<std::string> previousPaths;
+	std::unordered_set<std::string> keptPaths;
+
+	// Update the registered frames in place, so every holder of a frame sees the new tier.
+	// Frames that were packed into the dynamic atlas move back to their own texture.
+	for (const auto& pair : m_SplitSpriteFrameSources)
+	{
+		cocos2d::SpriteFrame* sf = nullptr;
+		if (!m_SplitSpriteFrames.Find(pair.first, sf))
+			continue;
+
+		const auto& source = pair.second;
+		const std::string filepath = GetSplitTexturePath(source.filename, basePath, Reader::i()->m_PathReplacements);
+		const std::string previousPath = GetSplitTexturePath(source.filename, previousBasePath, Reader::i()->m_PathReplacements);
+
+		// Usually already streamed in; frames registered while the switch was loading are loaded here
+		cocos2d::Texture2D* texture = textureCache->getTextureForKey(filepath);
+		if (!texture)
+			texture = textureCache->addImage(filepath);
+
+		if (!texture)
+		{
+			CCLOG("[SpriteFrameCache.SwitchSplitQuality]: Failed to load %s, keeping the old quality for %s", filepath.c_str(), pair.first.c_str());
+			keptPaths.insert(previousPath);
+			continue;
+		}
+
+		if (previousPath != filepath)
+			previousPaths.insert(previousPath);
+
+		sf->setTexture(texture);
+		sf->setRect(cocos2d::Rect(source.rect.origin.x * scale, source.rect.origin.y * scale, source.rect.size.width * scale, source.rect.size.height * scale));
+		sf->setOriginalSize(source.originalSize * scale);
+		sf->setOriginalSizeInPixels(source.originalSize * scale * CC_CONTENT_SCALE_FACTOR());
+		sf->setCenterRectInPixels(cocos2d::Rect(source.centerRect.origin.x * scale, source.centerRect.origin.y * scale, source.centerRect.size.width * scale, source.centerRect.size.height * scale));
+		switchedFrames.insert(sf);
+	}
+
+	SpriteFrameCache::RefreshSprites(cocos2d::Director::getInstance()->getRunningScene(), switchedFrames);
+
+	// Drop the previous tier's textures from the texture cache. Sprites not refreshed yet still hold theirs.
+	for (const auto& path : previousPaths)
+	{
+		if (!keptPaths.count(path))
+			textureCache->removeTextureForKey(path);
+	}
+}
+
+void SpriteFrameCache::RefreshSplitSprites(cocos2d::Node* root)
+{
+	std::unordered_set<cocos2d::SpriteFrame*> frames;
+	m_SplitSpriteFrames.ForEach([&frames](const std::string&, cocos2d::SpriteFrame* const& sf) {
+		frames.insert(sf);
+	});
+
+	SpriteFrameCache::RefreshSprites(root, frames);
+}
+
+void SpriteFrameCache::RefreshSprites(cocos2d::Node* root, const std::unordered_set<cocos2d::SpriteFrame*>& frames)
+{
+	// Sprites copy the frame's texture coordinates when it is set, so re-set it on every sprite showing one of the frames
+	auto refreshSprite = [&frames](cocos2d::Sprite* sprite) {
+		if (sprite && frames.count(sprite->getSpriteFrame()))
+		{
+			const cocos2d::Size contentSize = sprite->getContentSize();
+			sprite->setSpriteFrame(sprite->getSpriteFrame());
+			sprite->setContentSize(contentSize);
+		}
+	};
+
+	std::vector<cocos2d::Node*> stack;
+	if (root)
+		stack.push_back(root);
+
+	while (!stack.empty())
+	{
+		cocos2d::Node* node = stack.back();
+		stack.pop_back();
+
+		refreshSprite(dynamic_cast<cocos2d::Sprite*>(node));
+
+		// Renderers of these are protected children and not reachable through getChildren()
+		if (auto button = dynamic_cast<cocos2d::ui::Button*>(node))
+		{
+			refreshSprite(button->getRendererNormal());
+			refreshSprite(button->getRendererClicked());
+			refreshSprite(button->getRendererDisabled());
+		}
+		else if (auto progressTimer = dynamic_cast<cocos2d::ProgressTimer*>(node))
+		{
+			refreshSprite(progressTimer->getSprite());
+		}
+
+		for (auto child : node->getChildren())
+		{
+			stack.push_back(child);
 		}
 	}
 }
 
 void SpriteFrameCache::AddToNoSplit(const std::string& name, cocos2d::SpriteFrame* sf)
 {
-	assert(cocos2d::SpriteFrameCache::getInstance()->getSpriteFrameByName(name) == nullptr && "[SpriteFrameCache.AddToNoSplit]: Spriteframe already added");
+	assert(!this->IsRegistered(name) && "[SpriteFrameCache.AddToNoSplit]: Spriteframe already added");
 	
-	m_NoSplitSpriteFrames.emplace(name, sf);
-	cocos2d::SpriteFrameCache::getInstance()->addSpriteFrame(sf, name);
+	this->Register(FrameType::NoSplit, name, sf);
 }
 
 void SpriteFrameCache::AddToSplit(const std::string& name, cocos2d::SpriteFrame* sf)
 {
-	assert(cocos2d::SpriteFrameCache::getInstance()->getSpriteFrameByName(name) == nullptr && "[SpriteFrameCache.AddToSplit]: Spriteframe already added");
+	assert(!this->IsRegistered(name) && "[SpriteFrameCache.AddToSplit]: Spriteframe already added");
 	
-	 m_SplitSpriteFrames.emplace(name, sf);
-	cocos2d::SpriteFrameCache::getInstance()->addSpriteFrame(sf, name);
+	this->Register(FrameType::Split, name, sf);
 }
 
 void SpriteFrameCache::AddToAtlas(const std::string& name, cocos2d::SpriteFrame* sf)
 {
-	assert(cocos2d::SpriteFrameCache::getInstance()->getSpriteFrameByName(name) == nullptr && "[SpriteFrameCache.AddToAtlas]: Spriteframe already added");
+	assert(!this->IsRegistered(name) && "[SpriteFrameCache.AddToAtlas]: Spriteframe already added");
 	
-	m_AtlasSpriteFrames.emplace(name, sf);
-	cocos2d::SpriteFrameCache::getInstance()->addSpriteFrame(sf, name);
+	this->Register(FrameType::Atlas, name, sf);
+}
+
+void SpriteFrameCache::Register(FrameType type, const std::string& name, cocos2d::SpriteFrame* sf)
+{
+	auto& frames = type == FrameType::Split ? m_SplitSpriteFrames : (type == FrameType::NoSplit ? m_NoSplitSpriteFrames : m_AtlasSpriteFrames);
+	frames.Emplace(name, sf);
+
+	if (std::this_thread::get_id() == cocos2d::Director::getInstance()->getCocos2dThreadId())
+	{
+		cocos2d::SpriteFrameCache::getInstance()->addSpriteFrame(sf, name);
+		return;
+	}
+
+	// Keep it alive until it reaches the cocos cache
+	sf->retain();
+
+	std::vector<PendingSpriteFrame> pending(1);
+	pending[0].type = type;
+	pending[0].name = name;
+	pending[0].spriteFrame = sf;
+	this->Enqueue(pending);
 }
 
 NS_CCR_END
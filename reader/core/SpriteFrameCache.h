@@ -1,76 +1,191 @@
 #pragma once
 
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "cocos2d.h"
+#include "ui/CocosGUI.h"
 
 #include "../CreatorReader_generated.h"
 #include "../Macros.h"
+#include "DynamicAtlas.h"
+#include "ShardedMap.h"
 
 NS_CCR_BEGIN
 
 class Reader;
 
+// Reader settings the spriteframes of a load are read with (see Reader::GetSpriteFrameSettings). Taken on the cocos
+// thread when the load starts, so that loads on other threads do not read the reader's while it changes them.
+struct SpriteFrameSettings
+{
+	float rectScale = 1;
+	std::string basePath;
+	std::unordered_map<std::string, std::string> pathReplacements;
+};
+
 class SpriteFrameCache
 {
 	friend class Reader;
 
 private:
-	// A list of spriteframes used
+	// A list of spriteframes used. These can be read and registered from any thread.
 	// Spriteframes that have multiple sizes present for different resolutions
-	std::unordered_map<std::string, cocos2d::SpriteFrame*> m_SplitSpriteFrames;
+	ShardedMap<cocos2d::SpriteFrame*> m_SplitSpriteFrames;
 	// Spriteframes which are having only one size
-	std::unordered_map<std::string, cocos2d::SpriteFrame*> m_NoSplitSpriteFrames;
+	ShardedMap<cocos2d::SpriteFrame*> m_NoSplitSpriteFrames;
 	// Spriteframes which are part of a texture atlas
-	std::unordered_map<std::string, cocos2d::SpriteFrame*> m_AtlasSpriteFrames;
+	ShardedMap<cocos2d::SpriteFrame*> m_AtlasSpriteFrames;
+
+	// Unscaled source values of the split spriteframes, used to rebuild them for another quality tier
+	struct SplitSpriteFrameSource
+	{
+		// Path of the texture relative to the quality tier's directory
+		std::string filename;
+		cocos2d::Rect rect;
+		cocos2d::Size originalSize;
+		cocos2d::Rect centerRect;
+	};
+
+	// Only accessed on the cocos thread
+	std::unordered_map<std::string, SplitSpriteFrameSource> m_SplitSpriteFrameSources;
+	unsigned int m_QualitySwitchGeneration;
+	// Textures the latest switch loads
+	std::unordered_set<std::string> m_QualitySwitchPaths;
+
+	enum class FrameType
+	{
+		Split,
+		NoSplit,
+		Atlas
+	};
+
+	// A spriteframe registered off the cocos thread, waiting to be published to the cocos spriteframe cache.
+	// Textures can only be created on the cocos thread, so the loading thread only decodes the image.
+	struct PendingSpriteFrame
+	{
+		FrameType type;
+		std::string name;
+
+		// Already created frame (retained), or nullptr if it is created when published
+		cocos2d::SpriteFrame* spriteFrame = nullptr;
+
+		// Decoded image of standalone frames (retained), nullptr if decoding failed
+		cocos2d::Image* image = nullptr;
+		std::string filepath;
+		cocos2d::Rect rect;
+		bool rotated = false;
+		cocos2d::Vec2 offset;
+		cocos2d::Size originalSize;
+		cocos2d::Rect centerRect;
+		SplitSpriteFrameSource source;
+	};
+
+	std::mutex m_PendingMutex;
+	std::vector<PendingSpriteFrame> m_PendingSpriteFrames;
+	bool m_PublishScheduled;
+
+	// Packs standalone split/no_split spriteframes into shared pages, if enabled on the reader
+	DynamicAtlas m_DynamicAtlas;
+
+	// Expires with the cache. Functions queued on the cocos thread check it before using the cache.
+	std::shared_ptr<char> m_LifetimeToken;
 
 	static SpriteFrameCache* instance;
 
+	static std::string GetSplitTexturePath(const std::string& filename, const std::string& basePath, const std::unordered_map<std::string, std::string>& pathReplacements);
+	void ApplySplitQuality(float scale, const std::string& basePath);
+	std::unordered_set<std::string> GetSplitTexturePaths(const std::string& basePath) const;
+	static void RefreshSprites(cocos2d::Node* root, const std::unordered_set<cocos2d::SpriteFrame*>& frames);
+	cocos2d::SpriteFrame* CreateStandaloneSpriteFrame(const std::string& filepath, cocos2d::Image* image, const cocos2d::Rect& rect, bool rotated, const cocos2d::Vec2& offset, const cocos2d::Size& originalSize);
+
+	bool IsRegistered(const std::string& name) const;
+	void Publish(std::vector<PendingSpriteFrame>& frames);
+	void Enqueue(std::vector<PendingSpriteFrame>& frames);
+	void Register(FrameType type, const std::string& name, cocos2d::SpriteFrame* sf);
+
 public:
 	inline static SpriteFrameCache* i() { return SpriteFrameCache::instance; }
 	SpriteFrameCache();
 	~SpriteFrameCache();
 
+	/**
+	 Registers the spriteframes listed in a .ccreator buffer. Can be called from any thread: off the cocos thread
+	 the images are decoded right away, and the frames are published to the cocos spriteframe cache in one batch
+	 on the cocos thread (see PublishPendingSpriteFrames).
+	 @param settings	Scale and paths to read them with, taken on the cocos thread
+	 */
+	void AddSpriteFrames(const void* buffer, const SpriteFrameSettings& settings);
+
+	// Same, with the reader's current settings. Only on the cocos thread.
 	void AddSpriteFrames(const void* buffer = nullptr);
 
-    inline std::unordered_map<std::string, cocos2d::SpriteFrame*> GetSplitSpriteFrames() const { return m_SplitSpriteFrames; }
-	inline std::unordered_map<std::string, cocos2d::SpriteFrame*> GetNoSplitSpriteFrames() const { return m_NoSplitSpriteFrames; }
-	inline std::unordered_map<std::string, cocos2d::SpriteFrame*> GetAtlasSpriteFrames() const { return m_AtlasSpriteFrames; }
+	/**
+	 Creates and publishes all frames registered off the cocos thread so far. Runs on its own once per batch,
+	 call it to make sure they are available right now. Must be called on the cocos thread.
+	 */
+	void PublishPendingSpriteFrames();
+
+	// Looks a frame up in the registered frames, from any thread. Frames still pending publication are not found.
+	cocos2d::SpriteFrame* GetSpriteFrame(const std::string& name) const;
+
+	inline DynamicAtlas* GetDynamicAtlas() { return &m_DynamicAtlas; }
+
+	/**
+	 Removes all registered spriteframes from the cocos spriteframe cache and from the registry, and clears the
+	 dynamic atlas so sprites loaded afterwards do not pack into the previous scenes' pages. Sprites still showing
+	 a removed frame keep it. Must be called on the cocos thread.
+	 */
+	void RemoveSpriteFrames();
+
+	/**
+	 Moves all loaded split spriteframes to another quality tier without reloading the scene.
+	 The tier's textures are streamed in on the texture cache's loader thread; once all of them are ready
+	 the frames, and the sprites of the running scene showing them, are switched together on the cocos thread. The
+	 previous tier's textures are then removed from the texture cache.
+	 Sprites outside of the running scene (pushed scenes, nodes retained for later) keep the old texture coordinates:
+	 pass them to RefreshSplitSprites after the switch.
+	 @param scale		The new sprite rect scale (see Reader::SetSpriteRectScale)
+	 @param basePath	The new sprite base path (see Reader::SetSpriteBasePath)
+	 @param callback	Invoked on the cocos thread with true after the switch, or with false if a newer switch
+						superseded this one before its textures were loaded
+	 */
+	void SwitchSplitQuality(float scale, const std::string& basePath, const std::function<void(bool)>& callback = nullptr);
+
+	// Re-sets the split spriteframes on the sprites under `root` that show one, after a switch. Only on the cocos thread.
+	void RefreshSplitSprites(cocos2d::Node* root);
+
+    inline std::unordered_map<std::string, cocos2d::SpriteFrame*> GetSplitSpriteFrames() const { return m_SplitSpriteFrames.Snapshot(); }
+	inline std::unordered_map<std::string, cocos2d::SpriteFrame*> GetNoSplitSpriteFrames() const { return m_NoSplitSpriteFrames.Snapshot(); }
+	inline std::unordered_map<std::string, cocos2d::SpriteFrame*> GetAtlasSpriteFrames() const { return m_AtlasSpriteFrames.Snapshot(); }
 
 	inline bool IsSplit(cocos2d::SpriteFrame* sf)
     {
-        auto it = std::find_if(std::begin(m_SplitSpriteFrames), std::end(m_SplitSpriteFrames), [sf](const auto& pair) {
-			return pair.second == sf;
-		});
-
-		return it != std::end(m_SplitSpriteFrames);
+		return m_SplitSpriteFrames.AnyOf([sf](cocos2d::SpriteFrame* value) { return value == sf; });
     }
 
-	inline bool IsSplit(const std::string& name) { return m_SplitSpriteFrames.count(name) > 0; }
+	inline bool IsSplit(const std::string& name) { return m_SplitSpriteFrames.Contains(name); }
 
 	inline bool IsNoSplit(cocos2d::SpriteFrame* sf)
     {
-        auto it = std::find_if(std::begin(m_NoSplitSpriteFrames), std::end(m_NoSplitSpriteFrames), [sf](const auto& pair) {
-			return pair.second == sf;
-		});
-
-		return it != std::end(m_NoSplitSpriteFrames);
+		return m_NoSplitSpriteFrames.AnyOf([sf](cocos2d::SpriteFrame* value) { return value == sf; });
     }
 
-	inline bool IsNoSplit(const std::string& name) { return m_NoSplitSpriteFrames.count(name) > 0; }
+	inline bool IsNoSplit(const std::string& name) { return m_NoSplitSpriteFrames.Contains(name); }
 
 	inline bool IsPartOfAtlas(cocos2d::SpriteFrame* sf)
     {
-        auto it = std::find_if(std::begin(m_AtlasSpriteFrames), std::end(m_AtlasSpriteFrames), [sf](const auto& pair) {
-			return pair.second == sf;
-		});
-
-		return it != std::end(m_AtlasSpriteFrames);
+		return m_AtlasSpriteFrames.AnyOf([sf](cocos2d::SpriteFrame* value) { return value == sf; });
     }
 
-	inline bool IsPartOfAtlas(const std::string& name) { return m_AtlasSpriteFrames.count(name) > 0; }
-	
+	inline bool IsPartOfAtlas(const std::string& name) { return m_AtlasSpriteFrames.Contains(name); }
+
+	// These can be called from any thread; off the cocos thread the frame reaches the cocos cache with the next batch
 	void AddToNoSplit(const std::string& name, cocos2d::SpriteFrame* sf);
 	void AddToSplit(const std::string& name, cocos2d::SpriteFrame* sf);
 	void AddToAtlas(const std::string& name, cocos2d::SpriteFrame* sf);
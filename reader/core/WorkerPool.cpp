@@ -0,0 +1,112 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+NS_CCR_BEGIN
+
+WorkerPool::WorkerPool(unsigned int threadCount) :
+	m_Job(nullptr),
+	m_Count(0),
+	m_Grain(1),
+	m_NextIndex(0),
+	m_Generation(0),
+	m_Busy(0),
+	m_Quit(false)
+{
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+
+	for (unsigned int i = 0; i < threadCount; ++i)
+	{
+		m_Threads.emplace_back(&WorkerPool::WorkerLoop, this);
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Quit = true;
+	}
+
+	m_WorkReady.notify_all();
+	for (auto& thread : m_Threads)
+	{
+		thread.join();
+	}
+}
+
+void WorkerPool::Run(size_t count, size_t grain, const Job& job)
+{
+	if (count == 0)
+		return;
+
+	grain = std::max<size_t>(grain, 1);
+	if (m_Threads.empty() || count <= grain)
+	{
+		job(0, count);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Job = &job;
+		m_Count = count;
+		m_Grain = grain;
+		m_NextIndex = 0;
+		m_Busy = m_Threads.size();
+		++m_Generation;
+	}
+
+	m_WorkReady.notify_all();
+
+	// The calling thread takes ranges as well
+	this->Claim(job, count, grain);
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_WorkDone.wait(lock, [this]() { return m_Busy == 0; });
+	m_Job = nullptr;
+}
+
+void WorkerPool::Claim(const Job& job, size_t count, size_t grain)
+{
+	for (size_t begin = m_NextIndex.fetch_add(grain); begin < count; begin = m_NextIndex.fetch_add(grain))
+	{
+		job(begin, std::min(begin + grain, count));
+	}
+}
+
+void WorkerPool::WorkerLoop()
+{
+	uint32_t generation = 0;
+	for (;;)
+	{
+		const Job* job;
+		size_t count, grain;
+
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_WorkReady.wait(lock, [this, generation]() { return m_Quit || m_Generation != generation; });
+			if (m_Quit)
+				return;
+
+			generation = m_Generation;
+			job = m_Job;
+			count = m_Count;
+			grain = m_Grain;
+		}
+
+		this->Claim(*job, count, grain);
+
+		bool last;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			last = --m_Busy == 0;
+		}
+
+		if (last)
+			m_WorkDone.notify_one();
+	}
+}
+
+NS_CCR_END
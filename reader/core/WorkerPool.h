@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../Macros.h"
+
+NS_CCR_BEGIN
+
+// Threads kept around to split per-frame work over, where starting threads every time (as NodeDecoder does for
+// one-off loads) would cost more than the work itself. Idle workers sleep on a condition variable.
+class WorkerPool
+{
+public:
+	typedef std::function<void(size_t begin, size_t end)> Job;
+
+private:
+	std::vector<std::thread> m_Threads;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_WorkReady;
+	std::condition_variable m_WorkDone;
+
+	// Work of the current Run, see Claim
+	const Job* m_Job;
+	size_t m_Count;
+	size_t m_Grain;
+	std::atomic<size_t> m_NextIndex;
+
+	// Bumped by each Run, so a worker knows whether it has seen the work already
+	uint32_t m_Generation;
+	// Workers not done with the current Run yet
+	size_t m_Busy;
+	bool m_Quit;
+
+	void WorkerLoop();
+	// Runs chunks of the current job until none is left
+	void Claim(const Job& job, size_t count, size_t grain);
+
+public:
+	// `threadCount` workers besides the thread calling Run, 0 for one less than the number of hardware threads
+	explicit WorkerPool(unsigned int threadCount = 0);
+	~WorkerPool();
+
+	inline unsigned int GetThreadCount() const { return static_cast<unsigned int>(m_Threads.size()); }
+
+	/**
+	 Calls `job` over [0, count) in ranges of up to `grain`, on the workers and the calling thread. Threads take the
+	 next range from a shared counter as they finish one, so uneven ranges still balance out. Returns once every range
+	 is done. Not reentrant.
+	 */
+	void Run(size_t count, size_t grain, const Job& job);
+
+	CREATOR_DISALLOW_COPY_ASSIGN_AND_MOVE(WorkerPool);
+};
+
+NS_CCR_END